@@ -1,24 +1,21 @@
-QT       += core gui
+TEMPLATE = subdirs
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+# The recurrence / balance engine is a static library without QtWidgets, so it
+# can run headless; the calendar app, the command-line tool and the tests
+# (`make check`) all link it, and so does the widget benchmark.
+SUBDIRS += \
+    engine \
+    app \
+    cli \
+    tests \
+    widgetbench
 
-CONFIG += c++17
-
-# You can make your code fail to compile if it uses deprecated APIs.
-# In order to do so, uncomment the following line.
-#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
-
-SOURCES += \
-    main.cpp \
-    mainwindow.cpp
-
-HEADERS += \
-    mainwindow.h
-
-FORMS += \
-    mainwindow.ui
-
-# Default rules for deployment.
-qnx: target.path = /tmp/$${TARGET}/bin
-else: unix:!android: target.path = /opt/$${TARGET}/bin
-!isEmpty(target.path): INSTALLS += target
+engine.file = moneycalendarengine.pro
+app.file = moneycalendarapp.pro
+app.depends = engine
+cli.file = moneycalendarcli.pro
+cli.depends = engine
+tests.file = moneycalendartests.pro
+tests.depends = engine
+widgetbench.file = moneycalendarwidgetbench.pro
+widgetbench.depends = engine
@@ -0,0 +1,672 @@
+// balancekernels.cpp
+#include "balancekernels.h"
+#include "instrumentation.h"
+#include "recurrence.h"
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include <algorithm>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  define MC_SIMD_X86
+#  define MC_TARGET(isa) __attribute__((target(isa)))
+#  include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#  define MC_SIMD_X86
+#  define MC_TARGET(isa)
+#  include <immintrin.h>
+#  include <intrin.h>
+#endif
+
+using BalanceKernels::MaxBatch;
+using BalanceKernels::Target;
+typedef TransactionStore::Columns Columns;
+
+BalanceKernels::Target BalanceKernels::Target::fromDate(const QDate &date) {
+    return Target{ qint32(date.toJulianDay()), Recurrence::monthIndex(date), date.day(), date.daysInMonth() };
+}
+
+// ---- per-row rules ------------------------------------------------------------
+// Occurrences up to the target and "occurs on the target", written without
+// branches. The vector versions below compute exactly the same expressions.
+
+static inline qint64 oneTimeCount(qint32 startDay, const Target &t) {
+    return startDay <= t.day;
+}
+
+static inline bool oneTimeOn(qint32 startDay, const Target &t) {
+    return startDay == t.day;
+}
+
+static inline qint64 periodicCount(qint32 startDay, qint32 period, const Target &t) {
+    qint32 elapsed = t.day - startDay;
+    return (elapsed >= 0) * (elapsed / period + 1);
+}
+
+static inline bool periodicOn(qint32 startDay, qint32 period, const Target &t) {
+    qint32 elapsed = t.day - startDay;
+    return (elapsed >= 0) & (elapsed % period == 0);
+}
+
+static inline qint64 monthlyCount(qint32 startMonth, qint32 startDom, qint32 interval, const Target &t) {
+    qint32 elapsed = t.month - startMonth;
+    qint32 cycles = elapsed / interval;
+    // In a due month the occurrence only counts once its (clamped) day has come
+    qint32 dueThisMonth = (elapsed - cycles * interval) == 0;
+    qint32 notYet = t.dom < qMin(startDom, t.daysInMonth);
+    return (elapsed >= 0) * (cycles + 1 - (dueThisMonth & notYet));
+}
+
+static inline bool monthlyOn(qint32 startMonth, qint32 startDom, qint32 interval, const Target &t) {
+    qint32 elapsed = t.month - startMonth;
+    return (elapsed >= 0) & (elapsed % interval == 0) & (t.dom == qMin(startDom, t.daysInMonth));
+}
+
+// Every kernel adds the rows [begin, end) of one group into balances/nets
+// (cents). Without WithBalances only nets is written (balances may be null),
+// which skips the occurrence counts and their multiplies.
+
+// ---- scalar ----------------------------------------------------------------
+
+template <bool WithBalances>
+static void oneTimeScalar(const Columns &c, int begin, int end, const Target *targets, int count,
+                          qint64 *balances, qint64 *nets) {
+    const qint64 *amount = c.amount.constData();
+    const qint32 *startDay = c.startDay.constData();
+
+    for (int i = begin; i < end; ++i) {
+        for (int t = 0; t < count; ++t) {
+            if constexpr (WithBalances) balances[t] += amount[i] * oneTimeCount(startDay[i], targets[t]);
+            nets[t] += amount[i] * oneTimeOn(startDay[i], targets[t]);
+        }
+    }
+}
+
+template <bool WithBalances>
+static void periodicScalar(const Columns &c, qint32 period, int begin, int end, const Target *targets, int count,
+                           qint64 *balances, qint64 *nets) {
+    const qint64 *amount = c.amount.constData();
+    const qint32 *startDay = c.startDay.constData();
+
+    for (int i = begin; i < end; ++i) {
+        for (int t = 0; t < count; ++t) {
+            if constexpr (WithBalances) balances[t] += amount[i] * periodicCount(startDay[i], period, targets[t]);
+            nets[t] += amount[i] * periodicOn(startDay[i], period, targets[t]);
+        }
+    }
+}
+
+template <bool WithBalances>
+static void monthlyScalar(const Columns &c, int begin, int end, const Target *targets, int count,
+                          qint64 *balances, qint64 *nets) {
+    const qint64 *amount = c.amount.constData();
+    const qint32 *startMonth = c.startMonth.constData();
+    const qint32 *startDom = c.startDom.constData();
+    const qint32 *interval = c.interval.constData();
+
+    for (int i = begin; i < end; ++i) {
+        for (int t = 0; t < count; ++t) {
+            if constexpr (WithBalances) {
+                balances[t] += amount[i] * monthlyCount(startMonth[i], startDom[i], interval[i], targets[t]);
+            }
+            nets[t] += amount[i] * monthlyOn(startMonth[i], startDom[i], interval[i], targets[t]);
+        }
+    }
+}
+
+// The Rules group has no vector version: each row calls its own compiled
+// evaluator. Consecutive targets (the usual batch of days) only need one
+// count per row; after that each day adds whether it falls on that day.
+template <bool WithBalances>
+static void rulesScalar(const Columns &c, int begin, int end, const Target *targets, int count,
+                        qint64 *balances, qint64 *nets) {
+    for (int i = begin; i < end; ++i) {
+        const Recurrence::Rule &rule = c.rules[i];
+        qint64 amount = c.amount[i];
+        qint64 occurrences = 0;
+        for (int t = 0; t < count; ++t) {
+            bool on = rule.occursOn(targets[t].day);
+            if constexpr (WithBalances) {
+                bool next = t > 0 && targets[t].day == targets[t - 1].day + 1;
+                occurrences = next ? occurrences + on : rule.countUpTo(targets[t].day);
+                balances[t] += amount * occurrences;
+            }
+            nets[t] += amount * on;
+        }
+    }
+}
+
+#ifdef MC_SIMD_X86
+
+// ---- AVX2: 4 rows per step --------------------------------------------------
+// Day/month numbers are small integers, so they are compared and divided as
+// doubles (exact), and the resulting occurrence counts are multiplied into the
+// 64-bit cent amounts with integer instructions.
+
+MC_TARGET("avx2")
+static inline qint64 sum256(__m256i v) {
+    alignas(32) qint64 lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+MC_TARGET("avx2")
+static inline __m256d load4(const qint32 *p) {
+    return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+}
+
+// amount * count for counts in [0, 2^31), held as doubles. AVX2 has no 64-bit
+// multiply, so the amount is split into its 32-bit halves.
+MC_TARGET("avx2")
+static inline __m256i mulCount(__m256i amount, __m256d count) {
+    __m256i n = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(count));
+    __m256i low = _mm256_mul_epu32(amount, n);
+    __m256i high = _mm256_mul_epi32(_mm256_srli_epi64(amount, 32), n);
+    return _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+}
+
+MC_TARGET("avx2")
+static inline __m256i masked(__m256i amount, __m256d mask) {
+    return _mm256_and_si256(amount, _mm256_castpd_si256(mask));
+}
+
+template <bool WithBalances>
+MC_TARGET("avx2")
+static void oneTimeAvx2(const Columns &c, int begin, int end, const Target *targets, int count,
+                        qint64 *balances, qint64 *nets) {
+    const qint64 *amount = c.amount.constData();
+    const qint32 *startDay = c.startDay.constData();
+    const int vectorEnd = begin + (end - begin) / 4 * 4;
+
+    __m256i bal[MaxBatch], net[MaxBatch];
+    for (int t = 0; t < count; ++t) {
+        net[t] = _mm256_setzero_si256();
+        if constexpr (WithBalances) bal[t] = _mm256_setzero_si256();
+    }
+
+    for (int i = begin; i < vectorEnd; i += 4) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(amount + i));
+        __m256d start = load4(startDay + i);
+        for (int t = 0; t < count; ++t) {
+            __m256d day = _mm256_set1_pd(targets[t].day);
+            if constexpr (WithBalances) bal[t] = _mm256_add_epi64(bal[t], masked(a, _mm256_cmp_pd(start, day, _CMP_LE_OQ)));
+            net[t] = _mm256_add_epi64(net[t], masked(a, _mm256_cmp_pd(start, day, _CMP_EQ_OQ)));
+        }
+    }
+
+    for (int t = 0; t < count; ++t) {
+        if constexpr (WithBalances) balances[t] += sum256(bal[t]);
+        nets[t] += sum256(net[t]);
+    }
+    oneTimeScalar<WithBalances>(c, vectorEnd, end, targets, count, balances, nets);
+}
+
+template <bool WithBalances>
+MC_TARGET("avx2")
+static void periodicAvx2(const Columns &c, qint32 period, int begin, int end, const Target *targets, int count,
+                         qint64 *balances, qint64 *nets) {
+    const qint64 *amount = c.amount.constData();
+    const qint32 *startDay = c.startDay.constData();
+    const int vectorEnd = begin + (end - begin) / 4 * 4;
+    const __m256d p = _mm256_set1_pd(period);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d zero = _mm256_setzero_pd();
+
+    __m256i bal[MaxBatch], net[MaxBatch];
+    for (int t = 0; t < count; ++t) {
+        net[t] = _mm256_setzero_si256();
+        if constexpr (WithBalances) bal[t] = _mm256_setzero_si256();
+    }
+
+    for (int i = begin; i < vectorEnd; i += 4) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(amount + i));
+        __m256d start = load4(startDay + i);
+        for (int t = 0; t < count; ++t) {
+            __m256d elapsed = _mm256_sub_pd(_mm256_set1_pd(targets[t].day), start);
+            __m256d started = _mm256_cmp_pd(elapsed, zero, _CMP_GE_OQ);
+            __m256d cycles = _mm256_floor_pd(_mm256_div_pd(elapsed, p));
+            __m256d onDay = _mm256_cmp_pd(_mm256_mul_pd(cycles, p), elapsed, _CMP_EQ_OQ);
+            if constexpr (WithBalances) {
+                __m256d occurrences = _mm256_and_pd(started, _mm256_add_pd(cycles, one));
+                bal[t] = _mm256_add_epi64(bal[t], mulCount(a, occurrences));
+            }
+            net[t] = _mm256_add_epi64(net[t], masked(a, _mm256_and_pd(started, onDay)));
+        }
+    }
+
+    for (int t = 0; t < count; ++t) {
+        if constexpr (WithBalances) balances[t] += sum256(bal[t]);
+        nets[t] += sum256(net[t]);
+    }
+    periodicScalar<WithBalances>(c, period, vectorEnd, end, targets, count, balances, nets);
+}
+
+template <bool WithBalances>
+MC_TARGET("avx2")
+static void monthlyAvx2(const Columns &c, int begin, int end, const Target *targets, int count,
+                        qint64 *balances, qint64 *nets) {
+    const qint64 *amount = c.amount.constData();
+    const qint32 *startMonth = c.startMonth.constData();
+    const qint32 *startDom = c.startDom.constData();
+    const qint32 *interval = c.interval.constData();
+    const int vectorEnd = begin + (end - begin) / 4 * 4;
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d zero = _mm256_setzero_pd();
+
+    __m256i bal[MaxBatch], net[MaxBatch];
+    for (int t = 0; t < count; ++t) {
+        net[t] = _mm256_setzero_si256();
+        if constexpr (WithBalances) bal[t] = _mm256_setzero_si256();
+    }
+
+    for (int i = begin; i < vectorEnd; i += 4) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(amount + i));
+        __m256d month0 = load4(startMonth + i);
+        __m256d dom0 = load4(startDom + i);
+        __m256d iv = load4(interval + i);
+        for (int t = 0; t < count; ++t) {
+            __m256d elapsed = _mm256_sub_pd(_mm256_set1_pd(targets[t].month), month0);
+            __m256d started = _mm256_cmp_pd(elapsed, zero, _CMP_GE_OQ);
+            __m256d cycles = _mm256_floor_pd(_mm256_div_pd(elapsed, iv));
+            __m256d dueThisMonth = _mm256_cmp_pd(_mm256_mul_pd(cycles, iv), elapsed, _CMP_EQ_OQ);
+            __m256d dueDay = _mm256_min_pd(dom0, _mm256_set1_pd(targets[t].daysInMonth));
+            __m256d dom = _mm256_set1_pd(targets[t].dom);
+            __m256d onDay = _mm256_and_pd(dueThisMonth, _mm256_cmp_pd(dom, dueDay, _CMP_EQ_OQ));
+            if constexpr (WithBalances) {
+                __m256d notYet = _mm256_and_pd(dueThisMonth, _mm256_cmp_pd(dom, dueDay, _CMP_LT_OQ));
+                __m256d occurrences = _mm256_sub_pd(_mm256_add_pd(cycles, one), _mm256_and_pd(notYet, one));
+                bal[t] = _mm256_add_epi64(bal[t], mulCount(a, _mm256_and_pd(started, occurrences)));
+            }
+            net[t] = _mm256_add_epi64(net[t], masked(a, _mm256_and_pd(started, onDay)));
+        }
+    }
+
+    for (int t = 0; t < count; ++t) {
+        if constexpr (WithBalances) balances[t] += sum256(bal[t]);
+        nets[t] += sum256(net[t]);
+    }
+    monthlyScalar<WithBalances>(c, vectorEnd, end, targets, count, balances, nets);
+}
+
+// ---- SSE4.1: 2 rows per step (for _mm_floor_pd / _mm_mul_epi32) --------------
+
+MC_TARGET("sse4.1")
+static inline qint64 sum128(__m128i v) {
+    alignas(16) qint64 lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), v);
+    return lanes[0] + lanes[1];
+}
+
+MC_TARGET("sse4.1")
+static inline __m128d load2(const qint32 *p) {
+    return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+}
+
+MC_TARGET("sse4.1")
+static inline __m128i mulCount(__m128i amount, __m128d count) {
+    __m128i n = _mm_cvtepi32_epi64(_mm_cvtpd_epi32(count));
+    __m128i low = _mm_mul_epu32(amount, n);
+    __m128i high = _mm_mul_epi32(_mm_srli_epi64(amount, 32), n);
+    return _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+}
+
+MC_TARGET("sse4.1")
+static inline __m128i masked(__m128i amount, __m128d mask) {
+    return _mm_and_si128(amount, _mm_castpd_si128(mask));
+}
+
+template <bool WithBalances>
+MC_TARGET("sse4.1")
+static void oneTimeSse41(const Columns &c, int begin, int end, const Target *targets, int count,
+                         qint64 *balances, qint64 *nets) {
+    const qint64 *amount = c.amount.constData();
+    const qint32 *startDay = c.startDay.constData();
+    const int vectorEnd = begin + (end - begin) / 2 * 2;
+
+    __m128i bal[MaxBatch], net[MaxBatch];
+    for (int t = 0; t < count; ++t) {
+        net[t] = _mm_setzero_si128();
+        if constexpr (WithBalances) bal[t] = _mm_setzero_si128();
+    }
+
+    for (int i = begin; i < vectorEnd; i += 2) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(amount + i));
+        __m128d start = load2(startDay + i);
+        for (int t = 0; t < count; ++t) {
+            __m128d day = _mm_set1_pd(targets[t].day);
+            if constexpr (WithBalances) bal[t] = _mm_add_epi64(bal[t], masked(a, _mm_cmple_pd(start, day)));
+            net[t] = _mm_add_epi64(net[t], masked(a, _mm_cmpeq_pd(start, day)));
+        }
+    }
+
+    for (int t = 0; t < count; ++t) {
+        if constexpr (WithBalances) balances[t] += sum128(bal[t]);
+        nets[t] += sum128(net[t]);
+    }
+    oneTimeScalar<WithBalances>(c, vectorEnd, end, targets, count, balances, nets);
+}
+
+template <bool WithBalances>
+MC_TARGET("sse4.1")
+static void periodicSse41(const Columns &c, qint32 period, int begin, int end, const Target *targets, int count,
+                          qint64 *balances, qint64 *nets) {
+    const qint64 *amount = c.amount.constData();
+    const qint32 *startDay = c.startDay.constData();
+    const int vectorEnd = begin + (end - begin) / 2 * 2;
+    const __m128d p = _mm_set1_pd(period);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d zero = _mm_setzero_pd();
+
+    __m128i bal[MaxBatch], net[MaxBatch];
+    for (int t = 0; t < count; ++t) {
+        net[t] = _mm_setzero_si128();
+        if constexpr (WithBalances) bal[t] = _mm_setzero_si128();
+    }
+
+    for (int i = begin; i < vectorEnd; i += 2) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(amount + i));
+        __m128d start = load2(startDay + i);
+        for (int t = 0; t < count; ++t) {
+            __m128d elapsed = _mm_sub_pd(_mm_set1_pd(targets[t].day), start);
+            __m128d started = _mm_cmpge_pd(elapsed, zero);
+            __m128d cycles = _mm_floor_pd(_mm_div_pd(elapsed, p));
+            __m128d onDay = _mm_cmpeq_pd(_mm_mul_pd(cycles, p), elapsed);
+            if constexpr (WithBalances) {
+                __m128d occurrences = _mm_and_pd(started, _mm_add_pd(cycles, one));
+                bal[t] = _mm_add_epi64(bal[t], mulCount(a, occurrences));
+            }
+            net[t] = _mm_add_epi64(net[t], masked(a, _mm_and_pd(started, onDay)));
+        }
+    }
+
+    for (int t = 0; t < count; ++t) {
+        if constexpr (WithBalances) balances[t] += sum128(bal[t]);
+        nets[t] += sum128(net[t]);
+    }
+    periodicScalar<WithBalances>(c, period, vectorEnd, end, targets, count, balances, nets);
+}
+
+template <bool WithBalances>
+MC_TARGET("sse4.1")
+static void monthlySse41(const Columns &c, int begin, int end, const Target *targets, int count,
+                         qint64 *balances, qint64 *nets) {
+    const qint64 *amount = c.amount.constData();
+    const qint32 *startMonth = c.startMonth.constData();
+    const qint32 *startDom = c.startDom.constData();
+    const qint32 *interval = c.interval.constData();
+    const int vectorEnd = begin + (end - begin) / 2 * 2;
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d zero = _mm_setzero_pd();
+
+    __m128i bal[MaxBatch], net[MaxBatch];
+    for (int t = 0; t < count; ++t) {
+        net[t] = _mm_setzero_si128();
+        if constexpr (WithBalances) bal[t] = _mm_setzero_si128();
+    }
+
+    for (int i = begin; i < vectorEnd; i += 2) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(amount + i));
+        __m128d month0 = load2(startMonth + i);
+        __m128d dom0 = load2(startDom + i);
+        __m128d iv = load2(interval + i);
+        for (int t = 0; t < count; ++t) {
+            __m128d elapsed = _mm_sub_pd(_mm_set1_pd(targets[t].month), month0);
+            __m128d started = _mm_cmpge_pd(elapsed, zero);
+            __m128d cycles = _mm_floor_pd(_mm_div_pd(elapsed, iv));
+            __m128d dueThisMonth = _mm_cmpeq_pd(_mm_mul_pd(cycles, iv), elapsed);
+            __m128d dueDay = _mm_min_pd(dom0, _mm_set1_pd(targets[t].daysInMonth));
+            __m128d dom = _mm_set1_pd(targets[t].dom);
+            __m128d onDay = _mm_and_pd(dueThisMonth, _mm_cmpeq_pd(dom, dueDay));
+            if constexpr (WithBalances) {
+                __m128d notYet = _mm_and_pd(dueThisMonth, _mm_cmplt_pd(dom, dueDay));
+                __m128d occurrences = _mm_sub_pd(_mm_add_pd(cycles, one), _mm_and_pd(notYet, one));
+                bal[t] = _mm_add_epi64(bal[t], mulCount(a, _mm_and_pd(started, occurrences)));
+            }
+            net[t] = _mm_add_epi64(net[t], masked(a, _mm_and_pd(started, onDay)));
+        }
+    }
+
+    for (int t = 0; t < count; ++t) {
+        if constexpr (WithBalances) balances[t] += sum128(bal[t]);
+        nets[t] += sum128(net[t]);
+    }
+    monthlyScalar<WithBalances>(c, vectorEnd, end, targets, count, balances, nets);
+}
+
+// ---- CPU detection ----------------------------------------------------------
+
+static bool cpuHasAvx2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesAvx && (info[1] & (1 << 5));
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool cpuHasSse41() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    return info[2] & (1 << 19);
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+#endif // MC_SIMD_X86
+
+// ---- slices -----------------------------------------------------------------
+
+// Calls visit(chunk, begin, end) for the rows of one group that slice (of
+// slices) covers, chunk by chunk
+template <typename Visitor>
+static void forSliceRows(const TransactionStore &store, TransactionStore::Group group,
+                         int slice, int slices, Visitor visit) {
+    const QVector<Columns> &chunks = store.chunks(group);
+    qint64 rows = store.rowCount(group);
+    int first = int(rows * slice / slices);
+    int last = int(rows * (slice + 1) / slices);
+
+    for (int row = first; row < last; ) {
+        int chunk = row / TransactionStore::ChunkRows;
+        int begin = row % TransactionStore::ChunkRows;
+        int end = qMin(TransactionStore::ChunkRows, begin + (last - row));
+        visit(chunks.at(chunk), begin, end);
+        row += end - begin;
+    }
+}
+
+// Rows of the store a slice covers, about store.size() / slices
+[[maybe_unused]] static qint64 sliceRows(const TransactionStore &store, int slice, int slices) {
+    return qint64(store.size()) * (slice + 1) / slices - qint64(store.size()) * slice / slices;
+}
+
+// ---- overflow fallback ------------------------------------------------------
+
+// Money arithmetic row by row: slow, but saturates instead of wrapping.
+// balances may be null for nets only.
+static void projectChecked(const TransactionStore &store, int slice, int slices,
+                           const Target *targets, int count, Money *balances, Money *nets) {
+    for (int t = 0; t < count; ++t) {
+        const Target &target = targets[t];
+        Money balance, net;
+
+        forSliceRows(store, TransactionStore::OneTime, slice, slices, [&](const Columns &c, int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                Money amount = Money::fromCents(c.amount[i]);
+                if (balances) balance += amount * oneTimeCount(c.startDay[i], target);
+                if (oneTimeOn(c.startDay[i], target)) net += amount;
+            }
+        });
+
+        const TransactionStore::Group periodic[] = { TransactionStore::Weekly, TransactionStore::BiWeekly };
+        for (TransactionStore::Group group : periodic) {
+            qint32 period = (group == TransactionStore::Weekly) ? 7 : 14;
+            forSliceRows(store, group, slice, slices, [&](const Columns &c, int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    Money amount = Money::fromCents(c.amount[i]);
+                    if (balances) balance += amount * periodicCount(c.startDay[i], period, target);
+                    if (periodicOn(c.startDay[i], period, target)) net += amount;
+                }
+            });
+        }
+
+        forSliceRows(store, TransactionStore::Monthly, slice, slices, [&](const Columns &c, int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                Money amount = Money::fromCents(c.amount[i]);
+                if (balances) balance += amount * monthlyCount(c.startMonth[i], c.startDom[i], c.interval[i], target);
+                if (monthlyOn(c.startMonth[i], c.startDom[i], c.interval[i], target)) net += amount;
+            }
+        });
+
+        forSliceRows(store, TransactionStore::Rules, slice, slices, [&](const Columns &c, int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                Money amount = Money::fromCents(c.amount[i]);
+                if (balances) balance += amount * c.rules[i].countUpTo(target.day);
+                if (c.rules[i].occursOn(target.day)) net += amount;
+            }
+        });
+
+        if (balances) balances[t] = balance;
+        nets[t] = net;
+    }
+}
+
+// Upper bound on |balance| for these targets: rows * largest amount * most
+// occurrences any row can have had (weekly is the densest fixed schedule,
+// a rule may happen every day)
+static bool mayOverflow(const TransactionStore &store, const Target *targets, int count) {
+    if (store.isEmpty()) return false;
+
+    qint32 latest = targets[0].day;
+    for (int t = 1; t < count; ++t) {
+        latest = qMax(latest, targets[t].day);
+    }
+    double span = double(latest) - double(store.earliestStartDay());
+    if (span < 0) return false;
+
+    double occurrences = (store.rowCount(TransactionStore::Rules) > 0) ? span + 2.0 : span / 7.0 + 2.0;
+    double bound = double(store.size()) * double(store.largestAmount()) * occurrences;
+    return bound >= 4.0e18;
+}
+
+// The same for a day's net, where each row counts at most once
+static bool netsMayOverflow(const TransactionStore &store) {
+    return double(store.size()) * double(store.largestAmount()) >= 4.0e18;
+}
+
+// ---- dispatch ---------------------------------------------------------------
+
+namespace {
+
+typedef void (*OneTimeKernel)(const Columns &, int, int, const Target *, int, qint64 *, qint64 *);
+typedef void (*PeriodicKernel)(const Columns &, qint32, int, int, const Target *, int, qint64 *, qint64 *);
+typedef void (*MonthlyKernel)(const Columns &, int, int, const Target *, int, qint64 *, qint64 *);
+
+// Each kernel with balances ([1]) and nets only ([0])
+struct KernelSet {
+    const char *name;
+    OneTimeKernel oneTime[2];
+    PeriodicKernel periodic[2];
+    MonthlyKernel monthly[2];
+};
+
+#define MC_KERNELS(name, oneTime, periodic, monthly) \
+    { name, { oneTime<false>, oneTime<true> }, { periodic<false>, periodic<true> }, { monthly<false>, monthly<true> } }
+
+KernelSet detectKernels() {
+    const KernelSet scalar = MC_KERNELS("scalar", oneTimeScalar, periodicScalar, monthlyScalar);
+    QByteArray forced = qgetenv("MONEYCALENDAR_KERNELS");
+
+#ifdef MC_SIMD_X86
+    if (forced != "scalar" && forced != "sse4.1" && cpuHasAvx2()) {
+        return MC_KERNELS("avx2", oneTimeAvx2, periodicAvx2, monthlyAvx2);
+    }
+    if (forced != "scalar" && cpuHasSse41()) {
+        return MC_KERNELS("sse4.1", oneTimeSse41, periodicSse41, monthlySse41);
+    }
+#endif
+    Q_UNUSED(forced);
+    return scalar;
+}
+
+const KernelSet &kernels() {
+    static const KernelSet selected = detectKernels();
+    return selected;
+}
+
+} // namespace
+
+// The vector kernels over every group, in 64-bit cents; balances is only
+// written WithBalances
+template <bool WithBalances>
+static void projectColumns(const TransactionStore &store, int slice, int slices,
+                           const Target *targets, int count, Money *balances, Money *nets) {
+    qint64 balanceCents[MaxBatch] = {};
+    qint64 netCents[MaxBatch] = {};
+
+    const KernelSet &k = kernels();
+    forSliceRows(store, TransactionStore::OneTime, slice, slices, [&](const Columns &c, int begin, int end) {
+        k.oneTime[WithBalances](c, begin, end, targets, count, balanceCents, netCents);
+    });
+    forSliceRows(store, TransactionStore::Weekly, slice, slices, [&](const Columns &c, int begin, int end) {
+        k.periodic[WithBalances](c, 7, begin, end, targets, count, balanceCents, netCents);
+    });
+    forSliceRows(store, TransactionStore::BiWeekly, slice, slices, [&](const Columns &c, int begin, int end) {
+        k.periodic[WithBalances](c, 14, begin, end, targets, count, balanceCents, netCents);
+    });
+    forSliceRows(store, TransactionStore::Monthly, slice, slices, [&](const Columns &c, int begin, int end) {
+        k.monthly[WithBalances](c, begin, end, targets, count, balanceCents, netCents);
+    });
+    forSliceRows(store, TransactionStore::Rules, slice, slices, [&](const Columns &c, int begin, int end) {
+        rulesScalar<WithBalances>(c, begin, end, targets, count, balanceCents, netCents);
+    });
+
+    for (int t = 0; t < count; ++t) {
+        if constexpr (WithBalances) balances[t] = Money::fromCents(balanceCents[t]);
+        nets[t] = Money::fromCents(netCents[t]);
+    }
+}
+
+void BalanceKernels::project(const TransactionStore &store, const Target *targets, int count,
+                             Money *balances, Money *nets, int slice, int slices) {
+    Q_ASSERT(count <= MaxBatch);
+    Q_ASSERT(slice >= 0 && slice < slices);
+    if (count <= 0) return;
+
+    MC_TRACE_SCOPE("BalanceKernels::project");
+    MC_COUNT(TransactionsScanned, sliceRows(store, slice, slices));
+    MC_COUNT(OccurrencesEvaluated, sliceRows(store, slice, slices) * count);
+
+    if (mayOverflow(store, targets, count)) {
+        projectChecked(store, slice, slices, targets, count, balances, nets);
+    } else {
+        projectColumns<true>(store, slice, slices, targets, count, balances, nets);
+    }
+}
+
+void BalanceKernels::projectNets(const TransactionStore &store, const Target *targets, int count,
+                                 Money *nets, int slice, int slices) {
+    Q_ASSERT(count <= MaxBatch);
+    Q_ASSERT(slice >= 0 && slice < slices);
+    if (count <= 0) return;
+
+    MC_TRACE_SCOPE("BalanceKernels::projectNets");
+    MC_COUNT(TransactionsScanned, sliceRows(store, slice, slices));
+    MC_COUNT(OccurrencesEvaluated, sliceRows(store, slice, slices) * count);
+
+    if (netsMayOverflow(store)) {
+        projectChecked(store, slice, slices, targets, count, nullptr, nets);
+    } else {
+        projectColumns<false>(store, slice, slices, targets, count, nullptr, nets);
+    }
+}
+
+const char *BalanceKernels::instructionSet() {
+    return kernels().name;
+}
@@ -0,0 +1,47 @@
+// balancekernels.h
+#ifndef BALANCEKERNELS_H
+#define BALANCEKERNELS_H
+
+#include <QDate>
+
+#include "money.h"
+#include "transactionstore.h"
+
+// Vectorised balance / daily-net reductions over a TransactionStore. Every row
+// contributes amount * occurrences (and amount * occurs-on-the-day), which is a
+// masked multiply-add across the store's columns, done in 64-bit cents. AVX2 and SSE4.1 versions are
+// picked at runtime from the CPU, with a plain scalar loop as the fallback;
+// MONEYCALENDAR_KERNELS=scalar|sse4.1|avx2 forces a lower level.
+namespace BalanceKernels {
+
+// A target date broken into the fields the kernels compare against
+struct Target {
+    qint32 day;           // Julian day
+    qint32 month;         // Recurrence::monthIndex
+    qint32 dom;           // day of month
+    qint32 daysInMonth;
+
+    static Target fromDate(const QDate &date);
+};
+
+constexpr int MaxBatch = 42;   // a whole calendar page
+
+// Balance at the end of each target day and the net change on that day, for
+// up to MaxBatch targets in a single pass over the store. Ledgers big enough
+// to overflow 64 bits take a slower saturating path instead.
+// With slices > 1 only that share of every group's rows is summed, so the
+// parts can run on different threads and be added up afterwards.
+void project(const TransactionStore &store, const Target *targets, int count,
+             Money *balances, Money *nets, int slice = 0, int slices = 1);
+
+// Just the nets, for callers that sum them into balances themselves (see
+// BalanceTimeline::rebuild): no occurrence counts, so no multiplies
+void projectNets(const TransactionStore &store, const Target *targets, int count,
+                 Money *nets, int slice = 0, int slices = 1);
+
+// "avx2", "sse4.1" or "scalar"
+const char *instructionSet();
+
+} // namespace BalanceKernels
+
+#endif // BALANCEKERNELS_H
@@ -0,0 +1,187 @@
+// balancetimeline.cpp
+#include "balancetimeline.h"
+#include "balancekernels.h"
+#include "instrumentation.h"
+#include "recurrence.h"
+
+#include <QFuture>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <atomic>
+
+namespace {
+
+// Below this many row-days handing work to other threads costs more than it saves
+constexpr qint64 ParallelThreshold = 4 * 1024 * 1024;
+constexpr int MinSliceRows = 4096;
+constexpr int PrefixBlock = 2048;    // days per prefix-sum block
+
+// Runs work(0 .. count-1) on up to threads threads, the caller included. Each
+// thread keeps claiming the next unclaimed index, so uneven tasks even out.
+template <typename Work>
+void runParallel(QThreadPool *pool, int threads, int count, Work work) {
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int i = next++; i < count; i = next++) {
+            work(i);
+        }
+    };
+
+    QVector<QFuture<void>> helpers;
+    for (int t = 1; t < qMin(threads, count); ++t) {
+        helpers.append(QtConcurrent::run(pool, worker));
+    }
+    worker();
+    for (auto &helper : helpers) {
+        helper.waitForFinished();   // runs it here if no pool thread picked it up
+    }
+}
+
+} // namespace
+
+bool BalanceTimeline::covers(const QDate &date) const {
+    if (!valid || !date.isValid()) return false;
+    qint64 offset = date.toJulianDay() - firstDay;
+    return offset >= 0 && offset < balances.size();
+}
+
+bool BalanceTimeline::rebuild(const TransactionStore &store, const QDate &from, const QDate &to,
+                              const std::function<bool()> &cancelled, QThreadPool *pool) {
+    using BalanceKernels::MaxBatch;
+    MC_TRACE_SCOPE("BalanceTimeline::rebuild");
+
+    valid = false;
+    firstDay = from.toJulianDay();
+    int days = qMax(int(from.daysTo(to)) + 1, 0);
+    int batches = (days + MaxBatch - 1) / MaxBatch;
+
+    if (!pool) pool = QThreadPool::globalInstance();
+    int threads = 1;
+    if (qint64(store.size()) * days >= ParallelThreshold) {
+        threads = qMax(1, pool->maxThreadCount());
+    }
+
+    // Too few batches to keep every thread busy: split the rows as well
+    int slices = 1;
+    if (threads > 1 && batches < 2 * threads) {
+        slices = qMax(1, qMin((2 * threads + batches - 1) / qMax(batches, 1), store.size() / MinSliceRows));
+    }
+
+    // Slice 0 writes straight into deltas, the others into their own arrays
+    deltas.resize(days);
+    QVector<QVector<Money>> sliceDeltas(slices - 1);
+    for (auto &extra : sliceDeltas) {
+        extra.resize(days);
+    }
+
+    // Task 0 is the opening balance, then one task per (batch, slice)
+    Money opening;
+    std::atomic<bool> stopped{false};
+    runParallel(pool, threads, batches * slices + 1, [&](int task) {
+        if (stopped) return;
+        if (cancelled && cancelled()) {
+            stopped = true;
+            return;
+        }
+
+        if (task == 0) {
+            opening = store.balanceUpTo(from.addDays(-1));
+            return;
+        }
+        int batch = (task - 1) / slices;
+        int slice = (task - 1) % slices;
+
+        int start = batch * MaxBatch;
+        int count = qMin(MaxBatch, days - start);
+        BalanceKernels::Target targets[MaxBatch];
+        for (int i = 0; i < count; ++i) {
+            targets[i] = BalanceKernels::Target::fromDate(from.addDays(start + i));
+        }
+        // The balances come from the prefix sum below, so only nets are needed
+        Money *out = (slice == 0 ? deltas.data() : sliceDeltas[slice - 1].data()) + start;
+        BalanceKernels::projectNets(store, targets, count, out, slice, slices);
+    });
+    if (stopped) return false;
+
+    // Blocked prefix sum: block totals in parallel, a short serial scan over
+    // the totals, then every block writes its running balances in parallel
+    openingBalance = opening;
+    balances.resize(days);
+    Money *delta = deltas.data();
+    Money *balance = balances.data();
+    int blocks = (days + PrefixBlock - 1) / PrefixBlock;
+    QVector<Money> blockStart(blocks);
+
+    runParallel(pool, threads, blocks, [&](int block) {
+        int begin = block * PrefixBlock;
+        int end = qMin(days, begin + PrefixBlock);
+        Money total;
+        for (int i = begin; i < end; ++i) {
+            for (const auto &extra : sliceDeltas) {
+                delta[i] += extra[i];
+            }
+            total += delta[i];
+        }
+        blockStart[block] = total;
+    });
+
+    Money running = openingBalance;
+    for (Money &start : blockStart) {
+        Money total = start;
+        start = running;
+        running += total;
+    }
+
+    runParallel(pool, threads, blocks, [&](int block) {
+        int begin = block * PrefixBlock;
+        int end = qMin(days, begin + PrefixBlock);
+        Money sum = blockStart[block];
+        for (int i = begin; i < end; ++i) {
+            sum += delta[i];
+            balance[i] = sum;
+        }
+    });
+
+    valid = true;
+    return true;
+}
+
+void BalanceTimeline::add(const BalanceTimeline &other) {
+    Q_ASSERT(valid && other.valid && firstDay == other.firstDay && balances.size() == other.balances.size());
+
+    openingBalance += other.openingBalance;
+    for (int i = 0; i < balances.size(); ++i) {
+        deltas[i] += other.deltas[i];
+        balances[i] += other.balances[i];
+    }
+}
+
+void BalanceTimeline::apply(const Transaction &trans, int sign) {
+    if (!valid || balances.isEmpty()) return;
+    MC_TRACE_SCOPE("BalanceTimeline::apply");
+
+    Recurrence::Rule rule = Recurrence::Rule::compile(trans);
+    Money amount = (sign < 0) ? -trans.amount : trans.amount;
+    qint64 lastDay = firstDay + balances.size() - 1;
+    int before = rule.countUpTo(firstDay - 1);
+    int total = rule.countUpTo(lastDay);
+    MC_COUNT(OccurrencesEvaluated, total - before);
+
+    // Occurrences before the range move every balance; otherwise the days
+    // up to the first occurrence stay as they are
+    Money carried = amount * before;
+    openingBalance += carried;
+    int n = before;
+    qint64 next = (n < total) ? rule.nthDay(n) : lastDay + 1;
+    int first = (before > 0) ? 0 : int(next - firstDay);
+
+    for (int i = first; i < balances.size(); ++i) {
+        if (firstDay + i == next) {
+            deltas[i] += amount;
+            carried += amount;
+            next = (++n < total) ? rule.nthDay(n) : lastDay + 1;
+        }
+        balances[i] += carried;
+    }
+}
@@ -0,0 +1,58 @@
+// balancetimeline.h
+#ifndef BALANCETIMELINE_H
+#define BALANCETIMELINE_H
+
+#include <QVector>
+#include <QDate>
+
+#include <functional>
+
+#include "money.h"
+#include "transactionstore.h"
+
+class QThreadPool;
+
+// Running balance for every day of a fixed date range, so that looking up the
+// projected balance of a calendar cell is an array index instead of a pass over
+// the whole ledger. Built once per ledger change / page range, or once for a
+// long-range forecast (decades of days are split across all cores).
+class BalanceTimeline {
+public:
+    bool isValid() const { return valid; }
+    bool covers(const QDate &date) const;
+    QDate firstDate() const { return QDate::fromJulianDay(firstDay); }
+    QDate lastDate() const { return QDate::fromJulianDay(firstDay + balances.size() - 1); }
+
+    void invalidate() { valid = false; }
+    // Large jobs are cut into page-sized batches of days, and for short ranges
+    // also into slices of the rows, which pool (default: the global pool)
+    // works through in parallel before a blocked prefix sum joins them.
+    // cancelled is polled between batches, possibly from several threads; when
+    // it returns true the rebuild stops and the timeline is left invalid
+    // (returns false).
+    bool rebuild(const TransactionStore &store, const QDate &from, const QDate &to,
+                 const std::function<bool()> &cancelled = nullptr, QThreadPool *pool = nullptr);
+
+    // Adds (sign 1) or takes out (sign -1) one transaction's occurrences, for
+    // a single add or delete: costs that transaction's occurrences plus one
+    // pass over the days from its first one in the range, whatever the size
+    // of the ledger. Does nothing while invalid.
+    void apply(const Transaction &trans, int sign);
+
+    // Adds other's series day by day, e.g. to consolidate several ledgers;
+    // both must be valid over the same range
+    void add(const BalanceTimeline &other);
+
+    // Both require covers(date)
+    Money balanceOn(const QDate &date) const { return balances[date.toJulianDay() - firstDay]; }
+    Money netOn(const QDate &date) const { return deltas[date.toJulianDay() - firstDay]; }
+
+private:
+    qint64 firstDay = 0;           // Julian day of deltas[0]
+    Money openingBalance;          // balance at the end of the day before firstDay
+    QVector<Money> deltas;         // net change on each day of the range
+    QVector<Money> balances;       // openingBalance + prefix sums of deltas
+    bool valid = false;
+};
+
+#endif // BALANCETIMELINE_H
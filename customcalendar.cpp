@@ -0,0 +1,94 @@
+// customcalendar.cpp
+#include "customcalendar.h"
+#include "instrumentation.h"
+
+#include <QPainter>
+
+CustomCalendar::CustomCalendar(QWidget *parent) : QCalendarWidget(parent) {}
+
+void CustomCalendar::setProjections(const ProjectionService *projections) {
+    this->projections = projections;
+}
+
+void CustomCalendar::paintCell(QPainter *painter, const QRect &rect, QDate date) const {
+    MC_TRACE_SCOPE("CustomCalendar::paintCell");
+
+    // Draw default calendar cell (day number, background, etc.)
+    QCalendarWidget::paintCell(painter, rect, date);
+
+    if (!projections) return;
+
+    qreal ratio = painter->device()->devicePixelRatioF();
+
+    // Not projected yet: a faint marker until the worker's result arrives
+    const BalanceTimeline &timeline = projections->latest().timeline;
+    if (!timeline.covers(date)) {
+        painter->drawPixmap(rect.topLeft(), overlay(PendingMarker, rect.size(), ratio));
+        return;
+    }
+
+    // Net transaction amount on this exact day → green/red overlay
+    Money netOnDay = timeline.netOn(date);
+    if (!netOnDay.isZero()) {
+        painter->drawPixmap(rect.topLeft(), overlay(netOnDay.isPositive() ? IncomeTint : ExpenseTint, rect.size(), ratio));
+    }
+
+    // Projected balance up to this date (including this day) below zero → warning badge
+    if (timeline.balanceOn(date).isNegative()) {
+        painter->drawPixmap(rect.topLeft(), overlay(NegativeBadge, rect.size(), ratio));
+    }
+}
+
+const QPixmap &CustomCalendar::overlay(Overlay kind, const QSize &cellSize, qreal pixelRatio) const {
+    if (cellSize != overlaySize || pixelRatio != overlayRatio) {
+        renderOverlays(cellSize, pixelRatio);
+    }
+    return overlays[kind];
+}
+
+// Cells all have the same size, so this runs again only after a resize or a
+// move to a screen with another pixel ratio
+void CustomCalendar::renderOverlays(const QSize &cellSize, qreal pixelRatio) const {
+    MC_TRACE_SCOPE("CustomCalendar::renderOverlays");
+    overlaySize = cellSize;
+    overlayRatio = pixelRatio;
+    const QRect cell(QPoint(0, 0), cellSize);
+
+    for (QPixmap &pixmap : overlays) {
+        pixmap = QPixmap(cellSize * pixelRatio);
+        pixmap.setDevicePixelRatio(pixelRatio);
+        pixmap.fill(Qt::transparent);
+    }
+
+    QPainter pending(&overlays[PendingMarker]);
+    pending.setPen(QColor(150, 150, 150));
+    pending.drawText(cell.adjusted(2, 2, -4, -2), Qt::AlignRight | Qt::AlignBottom, "…");
+    pending.end();
+
+    const Overlay tints[] = { IncomeTint, ExpenseTint };
+    for (Overlay tint : tints) {
+        QPainter painter(&overlays[tint]);
+        painter.setPen(Qt::NoPen);
+        painter.setBrush(tint == IncomeTint ? QColor(0, 180, 0, 90) : QColor(220, 0, 0, 90));
+        painter.drawRect(cell.adjusted(2, 2, -2, -2));
+    }
+
+    QPainter badge(&overlays[NegativeBadge]);
+
+    // Small red warning circle with ! in the top-right corner
+    int size = qMin(cellSize.width(), cellSize.height()) / 4;  // e.g. 8–12 px
+    if (size < 10) size = 10;  // minimum readable size
+
+    QPoint center(cell.right() - size - 2, cell.top() + size + 2);
+
+    // Red circle
+    badge.setBrush(QColor(220, 30, 30));     // vivid red
+    badge.setPen(QColor(255, 255, 255, 180)); // light white border
+    badge.drawEllipse(center, size, size);
+
+    // White exclamation mark
+    badge.setPen(Qt::white);
+    badge.setFont(QFont("Arial", size * 1.4, QFont::Bold));
+    badge.drawText(QRect(center.x() - size, center.y() - size, size*2, size*2),
+                   Qt::AlignCenter, "!");
+}
@@ -0,0 +1,39 @@
+// customcalendar.h
+#ifndef CUSTOMCALENDAR_H
+#define CUSTOMCALENDAR_H
+
+#include <QCalendarWidget>
+#include <QPixmap>
+
+#include "projectionservice.h"
+
+// The month page, with each day's net tinted and a badge on days that end
+// below zero, painted from the latest projection
+class CustomCalendar : public QCalendarWidget {
+    Q_OBJECT
+
+public:
+    CustomCalendar(QWidget *parent = nullptr);
+    void setProjections(const ProjectionService *projections);
+
+    // Renders the overlays again on the next paint, as after a resize; the
+    // widget benchmark uses it to time a repaint without the cache
+    void dropOverlays() { overlaySize = QSize(); }
+
+protected:
+    // Changed: remove & from the third parameter
+    void paintCell(QPainter *painter, const QRect &rect, QDate date) const override;
+
+private:
+    // Cell overlays, rendered once per cell size and then only blitted
+    enum Overlay { PendingMarker, IncomeTint, ExpenseTint, NegativeBadge, OverlayCount };
+    const QPixmap &overlay(Overlay kind, const QSize &cellSize, qreal pixelRatio) const;
+    void renderOverlays(const QSize &cellSize, qreal pixelRatio) const;
+
+    const ProjectionService *projections = nullptr;   // paints from its latest result
+    mutable QPixmap overlays[OverlayCount];
+    mutable QSize overlaySize;
+    mutable qreal overlayRatio = 0;
+};
+
+#endif // CUSTOMCALENDAR_H
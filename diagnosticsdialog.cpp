@@ -0,0 +1,109 @@
+// diagnosticsdialog.cpp
+#include "diagnosticsdialog.h"
+#include "balancekernels.h"
+#include "instrumentation.h"
+
+#include <QDialogButtonBox>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QVBoxLayout>
+
+static QString milliseconds(quint64 nanoseconds) {
+    return QString::number(double(nanoseconds) / 1e6, 'f', 3);
+}
+
+DiagnosticsDialog::DiagnosticsDialog(QWidget *parent)
+    : QDialog(parent),
+    table(new QTableWidget(0, 5)),
+    countersLabel(new QLabel),
+    traceButton(new QPushButton("Record Trace")),
+    exportButton(new QPushButton("Export Trace...")) {
+    setWindowTitle("Diagnostics");
+    resize(640, 420);
+
+    table->setHorizontalHeaderLabels({ "Scope", "Calls", "Total (ms)", "Mean (ms)", "Max (ms)" });
+    table->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    table->verticalHeader()->hide();
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+
+    QPushButton *resetButton = new QPushButton("Reset");
+    traceButton->setCheckable(true);
+    traceButton->setChecked(Instrumentation::isTracing());
+    exportButton->setEnabled(Instrumentation::eventCount() > 0);
+
+    QHBoxLayout *buttons = new QHBoxLayout;
+    buttons->addWidget(resetButton);
+    buttons->addStretch();
+    buttons->addWidget(traceButton);
+    buttons->addWidget(exportButton);
+
+    QDialogButtonBox *close = new QDialogButtonBox(QDialogButtonBox::Close);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->addWidget(table);
+    layout->addWidget(countersLabel);
+    layout->addLayout(buttons);
+    layout->addWidget(close);
+
+    connect(resetButton, &QPushButton::clicked, this, &DiagnosticsDialog::onResetClicked);
+    connect(traceButton, &QPushButton::toggled, this, &DiagnosticsDialog::onTraceToggled);
+    connect(exportButton, &QPushButton::clicked, this, &DiagnosticsDialog::onExportClicked);
+    connect(close, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(&refreshTimer, &QTimer::timeout, this, &DiagnosticsDialog::refresh);
+
+    refreshTimer.start(500);
+    refresh();
+}
+
+void DiagnosticsDialog::refresh() {
+    QVector<Instrumentation::SiteStats> sites = Instrumentation::sites();
+    table->setRowCount(int(sites.size()));
+    for (int row = 0; row < sites.size(); ++row) {
+        const Instrumentation::SiteStats &site = sites[row];
+        quint64 mean = site.calls > 0 ? site.nanoseconds / site.calls : 0;
+        QStringList cells = { site.name, QString::number(site.calls), milliseconds(site.nanoseconds),
+                              milliseconds(mean), milliseconds(site.maxNanoseconds) };
+        for (int column = 0; column < cells.size(); ++column) {
+            QTableWidgetItem *item = new QTableWidgetItem(cells[column]);
+            if (column > 0) item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            table->setItem(row, column, item);
+        }
+    }
+
+    QStringList counters;
+    for (int c = 0; c < Instrumentation::CounterCount; ++c) {
+        auto counter = Instrumentation::Counter(c);
+        counters.append(QString("%1: %2").arg(Instrumentation::counterName(counter))
+                                         .arg(Instrumentation::counter(counter)));
+    }
+    counters.append(QString("kernels: %1").arg(BalanceKernels::instructionSet()));
+    if (Instrumentation::isTracing()) {
+        counters.append(QString("trace events: %1").arg(Instrumentation::eventCount()));
+    }
+    countersLabel->setText(counters.join("   "));
+    exportButton->setEnabled(Instrumentation::eventCount() > 0);
+}
+
+void DiagnosticsDialog::onResetClicked() {
+    Instrumentation::reset();
+    refresh();
+}
+
+void DiagnosticsDialog::onTraceToggled(bool on) {
+    Instrumentation::setTracing(on);
+    traceButton->setText(on ? "Stop Trace" : "Record Trace");
+    refresh();
+}
+
+void DiagnosticsDialog::onExportClicked() {
+    QString path = QFileDialog::getSaveFileName(this, "Export Trace", "moneycalendar-trace.json",
+                                                "Chrome trace (*.json)");
+    if (path.isEmpty()) return;
+
+    if (!Instrumentation::writeChromeTrace(path)) {
+        QMessageBox::warning(this, "Export Trace", "The trace could not be written to " + path + ".");
+    }
+}
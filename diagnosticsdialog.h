@@ -0,0 +1,34 @@
+// diagnosticsdialog.h
+#ifndef DIAGNOSTICSDIALOG_H
+#define DIAGNOSTICSDIALOG_H
+
+#include <QDialog>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+
+// Hidden panel (Ctrl+Shift+D in builds with CONFIG += instrumentation) showing
+// where the time goes: calls and time per instrumented scope, the counters,
+// and a switch to record a Chrome trace of the next clicks and repaints.
+class DiagnosticsDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit DiagnosticsDialog(QWidget *parent = nullptr);
+
+private slots:
+    void refresh();
+    void onResetClicked();
+    void onTraceToggled(bool on);
+    void onExportClicked();
+
+private:
+    QTableWidget *table;
+    QLabel *countersLabel;
+    QPushButton *traceButton;
+    QPushButton *exportButton;
+    QTimer refreshTimer;   // while the panel is open
+};
+
+#endif // DIAGNOSTICSDIALOG_H
@@ -0,0 +1,66 @@
+// eventlistmodel.cpp
+#include "eventlistmodel.h"
+#include "instrumentation.h"
+#include "recurrence.h"
+
+EventListModel::EventListModel(QObject *parent) : QAbstractListModel(parent) {
+}
+
+EventListModel::EventListModel(const Ledger &ledger, QObject *parent)
+    : QAbstractListModel(parent),
+    ledgers{ &ledger } {
+}
+
+void EventListModel::setLedgers(const QVector<const Ledger *> &ledgers) {
+    beginResetModel();
+    this->ledgers = ledgers;
+    ids.clear();
+    owners.clear();
+    endResetModel();
+}
+
+void EventListModel::setDate(const QDate &date) {
+    MC_TRACE_SCOPE("EventListModel::setDate");
+    beginResetModel();
+    shownDate = date;
+    owners.clear();
+    if (ledgers.size() == 1) {
+        ledgers.first()->transactionsOn(date, ids);
+    } else {
+        ids.clear();
+        for (int i = 0; i < ledgers.size(); ++i) {
+            ledgers[i]->transactionsOn(date, ledgerIds);
+            ids += ledgerIds;
+            owners.insert(owners.size(), ledgerIds.size(), i);
+        }
+    }
+    endResetModel();
+}
+
+int EventListModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : int(ids.size());
+}
+
+QVariant EventListModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= ids.size()) return QVariant();
+
+    int id = ids.at(index.row());
+    const Ledger *ledger = ledgers.at(ledgerAt(index.row()));
+    switch (role) {
+    case Qt::DisplayRole:
+        if (ledgers.size() > 1) return "[" + ledger->name() + "] " + text(ledger->transaction(id));
+        return text(ledger->transaction(id));
+    case TransactionIdRole:
+        return id;
+    default:
+        return QVariant();
+    }
+}
+
+QString EventListModel::text(const Transaction &trans) {
+    QString text = trans.description + " (" + trans.amount.toString() + ")";
+    if (trans.recurrence != RecurrenceType::None) {
+        text += " [" + Recurrence::describe(trans) + "]";
+    }
+    return text;
+}
@@ -0,0 +1,49 @@
+// eventlistmodel.h
+#ifndef EVENTLISTMODEL_H
+#define EVENTLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QDate>
+#include <QVector>
+
+#include "ledger.h"
+
+// The transactions falling on one day, as a list model over the ledgers'
+// occurrence indexes. Rows are just ids; the display text is only formatted
+// when a view asks for a visible row, and switching days is one reset that
+// reuses the id buffer. Listing several ledgers (the consolidated view)
+// prefixes every row with its ledger's name.
+class EventListModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    enum Role { TransactionIdRole = Qt::UserRole };
+
+    explicit EventListModel(QObject *parent = nullptr);
+    explicit EventListModel(const Ledger &ledger, QObject *parent = nullptr);
+
+    // The ledgers to list, which must outlive their use here; call setDate afterwards
+    void setLedgers(const QVector<const Ledger *> &ledgers);
+
+    // Shows date's transactions; call again after the ledger changes
+    void setDate(const QDate &date);
+    QDate date() const { return shownDate; }
+
+    int transactionIdAt(int row) const { return ids.at(row); }
+    int ledgerAt(int row) const { return owners.isEmpty() ? 0 : owners.at(row); }   // index into the ledgers set
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // e.g. "Rent (-1200.00) [Monthly]"
+    static QString text(const Transaction &trans);
+
+private:
+    QVector<const Ledger *> ledgers;
+    QDate shownDate;
+    QVector<int> ids;
+    QVector<int> owners;       // ledger of each row, empty with a single ledger
+    QVector<int> ledgerIds;    // scratch for merging several ledgers
+};
+
+#endif // EVENTLISTMODEL_H
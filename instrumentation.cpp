@@ -0,0 +1,211 @@
+// instrumentation.cpp
+#include "instrumentation.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+const char *const CounterNames[Instrumentation::CounterCount] = {
+    "transactionsScanned", "occurrencesEvaluated", "bytesWritten"
+};
+
+struct Event {
+    const char *name;
+    qint64 start;
+    qint64 duration;
+    int thread;
+    qint64 counters[Instrumentation::CounterCount];   // moved on this thread during the call
+};
+
+// Counters are kept per thread too, so an event only shows its own thread's work
+thread_local qint64 threadCounters[Instrumentation::CounterCount] = {};
+std::atomic<int> nextThread{0};
+thread_local int threadIndex = nextThread++;
+
+std::atomic<quint64> totals[Instrumentation::CounterCount];
+std::atomic<Instrumentation::Site *> firstSite{nullptr};
+std::atomic<bool> tracing{false};
+
+QMutex eventMutex;                 // guards events and traceStart
+QVector<Event> events;
+qint64 traceStart = 0;
+
+} // namespace
+
+Instrumentation::Site::Site(const char *name) : name(name) {
+    // Sites are function statics, so this runs once per site; push it onto the list
+    Site *head = firstSite.load();
+    do {
+        next = head;
+    } while (!firstSite.compare_exchange_weak(head, this));
+}
+
+bool Instrumentation::isEnabled() {
+#ifdef MONEYCALENDAR_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+QVector<Instrumentation::SiteStats> Instrumentation::sites() {
+    QVector<SiteStats> result;
+    for (Site *site = firstSite.load(); site; site = site->next) {
+        SiteStats stats;
+        stats.name = QString::fromLatin1(site->name);
+        stats.calls = site->calls;
+        stats.nanoseconds = site->nanoseconds;
+        stats.maxNanoseconds = site->maxNanoseconds;
+        result.append(stats);
+    }
+    std::sort(result.begin(), result.end(), [](const SiteStats &a, const SiteStats &b) {
+        return a.nanoseconds > b.nanoseconds;
+    });
+    return result;
+}
+
+quint64 Instrumentation::counter(Counter counter) {
+    return totals[counter];
+}
+
+const char *Instrumentation::counterName(Counter counter) {
+    return CounterNames[counter];
+}
+
+void Instrumentation::reset() {
+    for (Site *site = firstSite.load(); site; site = site->next) {
+        site->calls = 0;
+        site->nanoseconds = 0;
+        site->maxNanoseconds = 0;
+    }
+    for (auto &total : totals) {
+        total = 0;
+    }
+
+    QMutexLocker lock(&eventMutex);
+    events.clear();
+    traceStart = now();
+}
+
+void Instrumentation::setTracing(bool on) {
+    QMutexLocker lock(&eventMutex);
+    if (on && !tracing) {
+        events.clear();
+        traceStart = now();
+    }
+    tracing = on;
+}
+
+bool Instrumentation::isTracing() {
+    return tracing;
+}
+
+int Instrumentation::eventCount() {
+    QMutexLocker lock(&eventMutex);
+    return int(events.size());
+}
+
+QJsonObject Instrumentation::chromeTrace() {
+    QJsonArray traceEvents;
+    qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonObject process;
+    process["name"] = "process_name";
+    process["ph"] = "M";
+    process["pid"] = pid;
+    process["args"] = QJsonObject{ { "name", QCoreApplication::applicationName() } };
+    traceEvents.append(process);
+
+    QMutexLocker lock(&eventMutex);
+    for (const Event &event : events) {
+        if (event.start < traceStart) continue;   // began before the trace did
+
+        QJsonObject args;
+        for (int c = 0; c < CounterCount; ++c) {
+            if (event.counters[c] != 0) args[CounterNames[c]] = double(event.counters[c]);
+        }
+
+        QJsonObject json;
+        json["name"] = QString::fromLatin1(event.name);
+        json["cat"] = "moneycalendar";
+        json["ph"] = "X";
+        json["ts"] = double(event.start - traceStart) / 1000.0;   // microseconds
+        json["dur"] = double(event.duration) / 1000.0;
+        json["pid"] = pid;
+        json["tid"] = event.thread;
+        if (!args.isEmpty()) json["args"] = args;
+        traceEvents.append(json);
+    }
+
+    QJsonObject counters;
+    for (int c = 0; c < CounterCount; ++c) {
+        counters[CounterNames[c]] = double(totals[c].load());
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+    root["otherData"] = QJsonObject{ { "counters", counters }, { "droppedEvents", events.size() >= MaxEvents } };
+    return root;
+}
+
+bool Instrumentation::writeChromeTrace(const QString &path) {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write trace" << path << ":" << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(chromeTrace()).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qWarning() << "Could not write trace" << path << ":" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+qint64 Instrumentation::now() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Instrumentation::add(Counter counter, qint64 amount) {
+    threadCounters[counter] += amount;
+    totals[counter].fetch_add(quint64(amount), std::memory_order_relaxed);
+}
+
+Instrumentation::Scope::Scope(Site &site) : site(site), start(now()) {
+    std::copy(std::begin(threadCounters), std::end(threadCounters), counterStart);
+}
+
+Instrumentation::Scope::~Scope() {
+    qint64 duration = now() - start;
+    site.calls.fetch_add(1, std::memory_order_relaxed);
+    site.nanoseconds.fetch_add(quint64(duration), std::memory_order_relaxed);
+    quint64 longest = site.maxNanoseconds.load(std::memory_order_relaxed);
+    while (quint64(duration) > longest
+           && !site.maxNanoseconds.compare_exchange_weak(longest, quint64(duration), std::memory_order_relaxed)) {
+    }
+
+    if (!tracing.load(std::memory_order_relaxed)) return;
+
+    Event event;
+    event.name = site.name;
+    event.start = start;
+    event.duration = duration;
+    event.thread = threadIndex;
+    for (int c = 0; c < CounterCount; ++c) {
+        event.counters[c] = threadCounters[c] - counterStart[c];
+    }
+
+    QMutexLocker lock(&eventMutex);
+    if (events.size() < MaxEvents) events.append(event);
+}
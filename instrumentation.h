@@ -0,0 +1,93 @@
+// instrumentation.h
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+// Scoped timers and counters on the hot paths: painting, projecting, looking
+// up a day, saving. Only built with CONFIG += instrumentation, which defines
+// MONEYCALENDAR_INSTRUMENTATION; otherwise MC_TRACE_SCOPE and MC_COUNT expand
+// to nothing. Every scope keeps its call count and time. While tracing is on,
+// every call is also kept as an event, with the counters it moved, for a
+// Chrome trace (chrome://tracing or ui.perfetto.dev).
+namespace Instrumentation {
+
+enum Counter {
+    TransactionsScanned,    // rows read by the balance kernels and day lookups
+    OccurrencesEvaluated,   // row x day checks
+    BytesWritten,           // snapshots and journal records
+    CounterCount
+};
+
+// One MC_TRACE_SCOPE; lives as long as the program
+struct Site {
+    explicit Site(const char *name);
+
+    const char *name;
+    std::atomic<quint64> calls{0};
+    std::atomic<quint64> nanoseconds{0};
+    std::atomic<quint64> maxNanoseconds{0};
+    Site *next = nullptr;
+};
+
+struct SiteStats {
+    QString name;
+    quint64 calls = 0;
+    quint64 nanoseconds = 0;
+    quint64 maxNanoseconds = 0;
+};
+
+bool isEnabled();   // false unless built with MONEYCALENDAR_INSTRUMENTATION
+
+QVector<SiteStats> sites();   // by total time, largest first
+quint64 counter(Counter counter);
+const char *counterName(Counter counter);
+void reset();                 // zeroes the stats and counters, drops recorded events
+
+// Events are only recorded while tracing, at most MaxEvents of them
+constexpr int MaxEvents = 1 << 18;
+void setTracing(bool on);     // turning it on starts a fresh trace
+bool isTracing();
+int eventCount();
+
+// Trace-event JSON ("X" events, counters in args)
+QJsonObject chromeTrace();
+bool writeChromeTrace(const QString &path);
+
+// Used by the macros
+qint64 now();   // nanoseconds, monotonic
+void add(Counter counter, qint64 amount);
+
+class Scope {
+public:
+    explicit Scope(Site &site);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    Site &site;
+    qint64 start;
+    qint64 counterStart[CounterCount];
+};
+
+} // namespace Instrumentation
+
+#ifdef MONEYCALENDAR_INSTRUMENTATION
+#define MC_TRACE_JOIN2(a, b) a##b
+#define MC_TRACE_JOIN(a, b) MC_TRACE_JOIN2(a, b)
+#define MC_TRACE_SCOPE(name) \
+    static Instrumentation::Site MC_TRACE_JOIN(mcTraceSite, __LINE__)(name); \
+    Instrumentation::Scope MC_TRACE_JOIN(mcTraceScope, __LINE__)(MC_TRACE_JOIN(mcTraceSite, __LINE__))
+#define MC_COUNT(counter, amount) Instrumentation::add(Instrumentation::counter, qint64(amount))
+#else
+#define MC_TRACE_SCOPE(name) do {} while (0)
+#define MC_COUNT(counter, amount) do {} while (0)
+#endif
+
+#endif // INSTRUMENTATION_H
@@ -0,0 +1,433 @@
+// ledger.cpp
+#include "ledger.h"
+#include "balancekernels.h"
+#include "instrumentation.h"
+#include "statementreader.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QHash>
+
+#include <algorithm>
+#include <atomic>
+
+// Statements are read this many rows at a time, between progress reports
+static const int ImportBatchRows = 16384;
+
+// Imports this big are saved as a fresh snapshot rather than one huge journal record
+static const int ImportSnapshotRows = 2000;
+
+namespace {
+
+// What makes two statement rows the same transaction
+struct ImportKey {
+    qint64 day;
+    qint64 cents;
+    QString description;
+
+    bool operator==(const ImportKey &other) const {
+        return day == other.day && cents == other.cents && description == other.description;
+    }
+};
+
+size_t qHash(const ImportKey &key, size_t seed = 0) {
+    return qHashMulti(seed, key.day, key.cents, key.description);
+}
+
+ImportKey importKeyOf(const Transaction &trans) {
+    return { trans.startDate.toJulianDay(), trans.amount.cents(), trans.description };
+}
+
+} // namespace
+
+// Bytes per row of the occurrence index, on top of the store
+static const int IndexBytesPerRow = 32;
+
+static std::atomic<quint64> lastLedgerId{0};
+
+// A snapshot file is opened from its folder, but never written to
+static QString journalDirectory(const QString &path) {
+    QFileInfo info(path);
+    return info.isFile() ? info.absolutePath() : path;
+}
+
+Ledger::Ledger(const QString &path, bool readOnly)
+    : path(path),
+    readOnly(readOnly || QFileInfo(path).isFile()),
+    journal(journalDirectory(path)),
+    history(journalDirectory(path)),
+    id(++lastLedgerId) {
+}
+
+QString Ledger::name() const {
+    QFileInfo info(path);
+    return info.isFile() ? info.completeBaseName() : info.fileName();
+}
+
+qint64 Ledger::memoryUsage() const {
+    return store.memoryUsage() + archived.memoryUsage() + qint64(store.size() + archived.size()) * IndexBytesPerRow;
+}
+
+Transaction Ledger::transaction(int id) const {
+    return (archived.contains(id) && !store.contains(id)) ? archived.transaction(id) : store.transaction(id);
+}
+
+QVector<int> Ledger::transactionsOn(const QDate &date) const {
+    QVector<int> ids;
+    transactionsOn(date, ids);
+    return ids;
+}
+
+void Ledger::transactionsOn(const QDate &date, QVector<int> &ids) const {
+    index.transactionsOn(date, ids);
+    if (shownYears.contains(date.year())) {
+        ids += archivedIndex.transactionsOn(date);
+        std::sort(ids.begin(), ids.end());
+    }
+}
+
+bool Ledger::load() {
+    MC_TRACE_SCOPE("Ledger::load");
+
+    // Descriptions may point into the snapshot mapping the journal is about to replace
+    store.clear();
+    index.clear();
+
+    QVector<Transaction> loaded;
+    bool ok = QFileInfo(path).isFile() ? journal.loadSnapshot(path, loaded, nextId)
+                                       : journal.load(loaded, nextId, readOnly);
+    if (journal.snapshotUnreadable()) {
+        readOnly = true;   // edits would end up in a snapshot that drops everything else
+    }
+    store.assign(loaded);
+    index.rebuild(store);
+
+    shownYears.clear();
+    if (!QFileInfo(path).isFile()) {
+        ok = history.load() && ok;
+        // Finishes an archive run that stopped before its journal record, and
+        // moves entries added into archived years since
+        if (!readOnly && history.archivedBefore() > 0) {
+            archive(QDate(history.archivedBefore(), 1, 1));
+        }
+    }
+    rebuildArchived();
+
+    timeline.invalidate();
+    publish();
+    return ok;
+}
+
+bool Ledger::save() {
+    if (readOnly) return true;
+    MC_TRACE_SCOPE("Ledger::save");
+    return journal.compact(store, nextId);
+}
+
+int Ledger::add(Transaction trans) {
+    if (readOnly) {
+        qWarning() << "Could not add to read-only ledger" << path;
+        return -1;
+    }
+
+    MC_TRACE_SCOPE("Ledger::add");
+    trans.id = nextId++;
+    store.add(trans);
+    index.insert(trans);
+    timeline.apply(trans, 1);
+
+    publish();
+
+    journal.appendAdd(trans);
+    if (journal.needsCompaction()) {
+        journal.compactInBackground(store, nextId);
+    }
+    return trans.id;
+}
+
+int Ledger::remove(const QVector<int> &ids) {
+    if (readOnly) {
+        qWarning() << "Could not delete from read-only ledger" << path;
+        return 0;
+    }
+
+    MC_TRACE_SCOPE("Ledger::remove");
+    QVector<int> removed;
+    for (int id : ids) {
+        if (!store.contains(id)) continue;
+        Transaction trans = store.transaction(id);
+        index.remove(trans);
+        timeline.apply(trans, -1);
+        store.remove(id);
+        removed.append(id);
+    }
+    if (removed.isEmpty()) return 0;
+
+    publish();
+
+    journal.appendDelete(removed);
+    if (journal.needsCompaction()) {
+        journal.compactInBackground(store, nextId);
+    }
+    return removed.size();
+}
+
+// Stands in for an archived year that isn't shown: all it added, on its last
+// day. Its id is below -1 (see TransactionStore::add), so it never meets one
+// that add() hands out.
+static Transaction checkpointOf(const LedgerArchive::Year &year, int id) {
+    Transaction trans;
+    trans.id = id;
+    trans.startDate = QDate(year.year, 12, 31);
+    trans.description = QString("Archived %1 (%2 transactions)").arg(year.year).arg(year.count);
+    trans.amount = year.balance;
+    return trans;
+}
+
+int Ledger::archive(const QDate &before) {
+    if (readOnly || QFileInfo(path).isFile() || !before.isValid()) return 0;
+    MC_TRACE_SCOPE("Ledger::archive");
+
+    // Only the one-time group's date column is scanned to find them
+    qint32 cutoff = qint32(QDate(before.year(), 1, 1).toJulianDay());
+    QVector<Transaction> settled;
+    for (const TransactionStore::Columns &chunk : store.chunks(TransactionStore::OneTime)) {
+        for (int row = 0; row < chunk.size(); ++row) {
+            if (chunk.startDay[row] < cutoff) settled.append(store.transaction(chunk.ids[row]));
+        }
+    }
+    if (settled.isEmpty()) return 0;
+
+    // The archive is written first: if we stop before the journal record
+    // below, the next load() finds the rows in both and finishes the job
+    if (!history.archive(settled, before.year())) {
+        history.load();   // back to what is on disk
+        return 0;
+    }
+
+    QVector<int> ids;
+    for (const Transaction &trans : settled) {
+        index.remove(trans);
+        store.remove(trans.id);
+        ids.append(trans.id);
+    }
+    rebuildArchived();
+    timeline.invalidate();
+    publish();
+
+    if (ids.size() >= ImportSnapshotRows) {
+        journal.compact(store, nextId);
+    } else {
+        journal.appendDelete(ids);
+        if (journal.needsCompaction()) {
+            journal.compactInBackground(store, nextId);
+        }
+    }
+    return int(ids.size());
+}
+
+bool Ledger::showArchive(const QDate &from, const QDate &to) {
+    QSet<int> years;
+    for (const LedgerArchive::Year &year : history.years()) {
+        if (year.year >= from.year() && year.year <= to.year()) years.insert(year.year);
+    }
+    if (years == shownYears) return false;
+
+    shownYears = years;
+    rebuildArchived();
+    timeline.invalidate();
+    publish();
+    return true;
+}
+
+void Ledger::rebuildArchived() {
+    MC_TRACE_SCOPE("Ledger::rebuildArchived");
+    archived.clear();
+    archivedIndex.clear();
+
+    int checkpointId = -2;
+    for (const LedgerArchive::Year &year : history.years()) {
+        QVector<Transaction> rows;
+        if (shownYears.contains(year.year) && history.readYear(year.year, rows)) {
+            for (const Transaction &trans : rows) {
+                if (store.contains(trans.id)) continue;   // read-only, and an archive run was cut short
+                archived.add(trans);
+                archivedIndex.insert(trans);
+            }
+            continue;
+        }
+        shownYears.remove(year.year);
+        archived.add(checkpointOf(year, checkpointId--));
+    }
+}
+
+void Ledger::publish() {
+    auto next = std::make_shared<LedgerVersion>();
+    next->ledger = id;
+    next->version = ++version;
+    next->store = store;   // shares every chunk until the next edit touches it
+    next->archived = archived;
+    std::atomic_store(&published, LedgerSnapshot(std::move(next)));
+}
+
+Ledger::ImportResult Ledger::import(const QString &statementPath, const ImportProgress &progress) {
+    ImportResult result;
+    if (readOnly) {
+        qWarning() << "Could not import into read-only ledger" << path;
+        result.ok = false;
+        return result;
+    }
+
+    MC_TRACE_SCOPE("Ledger::import");
+    StatementReader reader(statementPath);
+    if (!reader.open()) {
+        result.ok = false;
+        return result;
+    }
+
+    // How many copies of each one-time row the ledger has. A matching
+    // statement row uses one up, so importing a statement twice adds nothing
+    // while rows that really repeat (two equal coffees on a day) still do.
+    QHash<ImportKey, int> existing;
+    for (const Transaction &trans : store.toVector()) {
+        if (trans.recurrence == RecurrenceType::None) {
+            ++existing[importKeyOf(trans)];
+        }
+    }
+
+    QSet<int> keyedYears;
+
+    QVector<Transaction> added;
+    QVector<Transaction> batch;
+    while (!reader.atEnd()) {
+        batch.clear();
+        if (reader.read(batch, ImportBatchRows) == 0 && !reader.atEnd()) {
+            // Nothing read but not at the end either: the file can't be read any further
+            qWarning() << "Could not read statement" << statementPath << "past byte" << reader.bytesRead();
+            result.ok = false;
+            return result;
+        }
+
+        for (const Transaction &trans : batch) {
+            // Archived years count too, read the first time a row falls in one
+            int year = trans.startDate.year();
+            if (history.contains(year) && !keyedYears.contains(year)) {
+                QVector<Transaction> rows;
+                if (!history.readYear(year, rows)) {
+                    qWarning() << "Could not read archived year" << year << "to check the statement against";
+                    result.ok = false;
+                    return result;
+                }
+                for (const Transaction &row : rows) {
+                    if (row.recurrence == RecurrenceType::None && !store.contains(row.id)) {
+                        ++existing[importKeyOf(row)];
+                    }
+                }
+                keyedYears.insert(year);
+            }
+
+            auto found = existing.find(importKeyOf(trans));
+            if (found != existing.end() && found.value() > 0) {
+                --found.value();
+                ++result.duplicates;
+                continue;
+            }
+            added.append(trans);
+        }
+
+        if (progress && !progress(reader.bytesRead(), reader.bytesTotal())) {
+            result.cancelled = true;
+            return result;
+        }
+    }
+    result.rejected = reader.rejectedRows();
+    if (added.isEmpty()) return result;
+
+    for (Transaction &trans : added) {
+        trans.id = nextId++;
+        store.add(trans);
+        index.insert(trans);
+    }
+    result.added = int(added.size());
+    timeline.invalidate();
+    publish();
+
+    if (added.size() >= ImportSnapshotRows) {
+        result.ok = journal.compact(store, nextId);
+    } else {
+        result.ok = journal.appendAdds(added);
+        if (journal.needsCompaction()) {
+            journal.compactInBackground(store, nextId);
+        }
+    }
+    return result;
+}
+
+Money Ledger::balanceOn(const QDate &date) const {
+    if (timeline.covers(date)) {
+        return timeline.balanceOn(date);
+    }
+    return store.balanceUpTo(date) + archived.balanceUpTo(date);   // one pass over the columns
+}
+
+Money Ledger::netOn(const QDate &date) const {
+    if (timeline.covers(date)) {
+        return timeline.netOn(date);
+    }
+    return index.netAmountOn(date) + archived.netOn(date);   // only touches that day's items
+}
+
+bool Ledger::isCached(const QDate &from, const QDate &to) const {
+    return timeline.covers(from) && timeline.covers(to);
+}
+
+void Ledger::cacheRange(const QDate &from, const QDate &to) {
+    if (isCached(from, to)) return;
+    rebuild(timeline, from, to);
+}
+
+BalanceTimeline Ledger::forecast(const QDate &from, const QDate &to) const {
+    BalanceTimeline result;
+    rebuild(result, from, to);
+    return result;
+}
+
+// The store's series plus the archive's
+void Ledger::rebuild(BalanceTimeline &result, const QDate &from, const QDate &to) const {
+    result.rebuild(store, from, to);
+    if (archived.isEmpty() || !result.isValid()) return;
+
+    BalanceTimeline part;
+    part.rebuild(archived, from, to);
+    result.add(part);
+}
+
+void Ledger::project(const QDate &from, const QDate &to, const DaySink &sink) const {
+    if (!from.isValid() || !to.isValid()) return;
+    MC_TRACE_SCOPE("Ledger::project");
+
+    BalanceKernels::Target targets[BalanceKernels::MaxBatch];
+    Money balances[BalanceKernels::MaxBatch];
+    Money nets[BalanceKernels::MaxBatch];
+    Money archivedBalances[BalanceKernels::MaxBatch];
+    Money archivedNets[BalanceKernels::MaxBatch];
+
+    for (QDate start = from; start <= to; start = start.addDays(BalanceKernels::MaxBatch)) {
+        int count = int(qMin<qint64>(BalanceKernels::MaxBatch, start.daysTo(to) + 1));
+        for (int i = 0; i < count; ++i) {
+            targets[i] = BalanceKernels::Target::fromDate(start.addDays(i));
+        }
+        BalanceKernels::project(store, targets, count, balances, nets);
+        if (!archived.isEmpty()) {
+            BalanceKernels::project(archived, targets, count, archivedBalances, archivedNets);
+            for (int i = 0; i < count; ++i) {
+                balances[i] += archivedBalances[i];
+                nets[i] += archivedNets[i];
+            }
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (!sink(start.addDays(i), balances[i], nets[i])) return;
+        }
+    }
+}
@@ -0,0 +1,127 @@
+// ledger.h
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include <QDate>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+
+#include "balancetimeline.h"
+#include "ledgerarchive.h"
+#include "ledgerjournal.h"
+#include "money.h"
+#include "occurrenceindex.h"
+#include "transactionstore.h"
+
+// One published state of a ledger. Never modified once published, so any
+// thread may read it without locking.
+struct LedgerVersion {
+    quint64 ledger = 0;            // which Ledger object, unique within the process
+    quint64 version = 0;           // increases with every edit
+    TransactionStore store;
+    TransactionStore archived;     // checkpoints of archived years, rows of the shown ones; projected with store
+};
+typedef std::shared_ptr<const LedgerVersion> LedgerSnapshot;
+
+// One ledger with everything needed to edit and project it: the column store,
+// its journal on disk, the per-day occurrence index and a cached balance
+// timeline, plus the archive of its settled history. Has no GUI
+// dependencies; the calendar window and the command-line tool both sit on
+// top of it.
+class Ledger {
+public:
+    // path is a ledger directory (snapshot + journal) or, read-only, a single
+    // snapshot file (.json / .mcl)
+    explicit Ledger(const QString &path, bool readOnly = false);
+
+    bool load();
+    bool save();   // folds the journal into a fresh snapshot
+    bool isReadOnly() const { return readOnly; }
+    QString name() const;          // the folder's (or snapshot file's) name
+    qint64 memoryUsage() const;    // rough bytes held in memory, see Workspace
+
+    const TransactionStore &transactions() const { return store; }   // without the archive
+    Transaction transaction(int id) const;
+    QVector<int> transactionsOn(const QDate &date) const;
+    void transactionsOn(const QDate &date, QVector<int> &ids) const;
+
+    // The latest version, for readers on other threads. The ledger itself is
+    // only ever edited from one thread; each edit publishes a new version that
+    // shares all unchanged chunks with the previous one, and an old version is
+    // freed when its last reader lets go of it.
+    LedgerSnapshot snapshot() const { return std::atomic_load(&published); }
+
+    int add(Transaction trans);                // assigns and returns the id, -1 if read-only
+    int remove(const QVector<int> &ids);       // number actually removed; archived ones can't be
+
+    // Moves one-time transactions from the years before `before` into the
+    // archive (see LedgerArchive). Each archived year then counts as one
+    // checkpoint transaction on its last day, so the balances from its end on
+    // stay exact; days inside it are only exact while the year is shown.
+    // Returns the number of transactions moved.
+    int archive(const QDate &before);
+    int archivedBefore() const { return history.archivedBefore(); }   // a year, 0 if none
+
+    // Loads the archived years that overlap from..to in place of their
+    // checkpoints and drops the others again. Returns whether that changed
+    // anything, i.e. whether projections must be redone.
+    bool showArchive(const QDate &from, const QDate &to);
+
+    // Bulk-loads a bank statement (see StatementReader) as one edit: rows the
+    // ledger already has (same date, amount and description) are skipped, the
+    // rest get one index / timeline update, one new version and one write to
+    // disk. progress(bytesRead, bytesTotal) returning false cancels the import
+    // without changing anything.
+    struct ImportResult {
+        int added = 0;
+        int duplicates = 0;
+        int rejected = 0;          // rows without a readable date or amount
+        bool cancelled = false;
+        bool ok = true;            // false if the statement or the ledger couldn't be read / written
+    };
+    typedef std::function<bool(qint64 done, qint64 total)> ImportProgress;
+    ImportResult import(const QString &statementPath, const ImportProgress &progress = nullptr);
+
+    // Balance at the end of date / net change on date; cheap inside the cached range
+    Money balanceOn(const QDate &date) const;
+    Money netOn(const QDate &date) const;
+
+    bool isCached(const QDate &from, const QDate &to) const;
+    void cacheRange(const QDate &from, const QDate &to);
+
+    // Daily balance / net for from..to, e.g. a decades-long forecast; the
+    // range is split across all cores (see BalanceTimeline::rebuild)
+    BalanceTimeline forecast(const QDate &from, const QDate &to) const;
+
+    // Calls sink(date, balance, net) for every day from..to, one page-sized
+    // batch at a time, so arbitrarily long ranges need no extra memory.
+    // Returning false from sink stops early.
+    typedef std::function<bool(const QDate &date, Money balance, Money net)> DaySink;
+    void project(const QDate &from, const QDate &to, const DaySink &sink) const;
+
+private:
+    void publish();
+    void rebuildArchived();
+    void rebuild(BalanceTimeline &timeline, const QDate &from, const QDate &to) const;
+
+    QString path;
+    bool readOnly;
+    TransactionStore store;
+    LedgerJournal journal;         // snapshot + append-only log of edits
+    OccurrenceIndex index;         // which transactions fall on a given day
+    LedgerArchive history;
+    TransactionStore archived;     // see LedgerVersion::archived
+    OccurrenceIndex archivedIndex; // rows of the shown archived years
+    QSet<int> shownYears;          // archived years loaded into archived
+    BalanceTimeline timeline;      // daily balances over the cached range
+    int nextId = 0;
+    quint64 id;                    // see LedgerVersion::ledger
+    quint64 version = 0;
+    LedgerSnapshot published;      // only swapped with std::atomic_store
+};
+
+#endif // LEDGER_H
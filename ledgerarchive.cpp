@@ -0,0 +1,190 @@
+// ledgerarchive.cpp
+#include "ledgerarchive.h"
+#include "instrumentation.h"
+#include "ledgerjournal.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMap>
+#include <QSaveFile>
+#include <QSet>
+
+#include <algorithm>
+
+LedgerArchive::LedgerArchive(const QString &directory)
+    : directory(directory + "/archive") {
+}
+
+QString LedgerArchive::checkpointsPath() const {
+    return directory + "/checkpoints.json";
+}
+
+QString LedgerArchive::partitionPath(int year) const {
+    return directory + "/" + QString::number(year) + ".mca";
+}
+
+bool LedgerArchive::contains(int year) const {
+    return std::any_of(checkpoints.begin(), checkpoints.end(), [&](const Year &y) { return y.year == year; });
+}
+
+bool LedgerArchive::load() {
+    checkpoints.clear();
+    before = 0;
+
+    QFile file(checkpointsPath());
+    if (!file.exists()) return true;   // nothing archived yet
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not read archive checkpoints:" << file.errorString();
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) {
+        qWarning() << "Invalid JSON in archive checkpoints";
+        return false;
+    }
+
+    QJsonObject root = doc.object();
+    before = root["archivedBefore"].toInt(0);
+    for (const auto &value : root["years"].toArray()) {
+        QJsonObject obj = value.toObject();
+        Year year;
+        year.year = obj["year"].toInt();
+        year.balance = Money::fromCents(obj["balanceCents"].toInteger());
+        year.count = obj["count"].toInt();
+        checkpoints.append(year);
+    }
+    std::sort(checkpoints.begin(), checkpoints.end(), [](const Year &a, const Year &b) { return a.year < b.year; });
+    return true;
+}
+
+bool LedgerArchive::archive(const QVector<Transaction> &rows, int before) {
+    MC_TRACE_SCOPE("LedgerArchive::archive");
+    if (!QDir().mkpath(directory)) {
+        qWarning() << "Could not create archive folder" << directory;
+        return false;
+    }
+
+    QMap<int, QVector<Transaction>> byYear;
+    for (const Transaction &trans : rows) {
+        byYear[trans.startDate.year()].append(trans);
+    }
+
+    // A partition may exist without a checkpoint if an earlier run stopped
+    // between the two, so always merge with whatever is on disk. The
+    // checkpoint is then summed from the merged partition, never patched.
+    for (auto it = byYear.begin(); it != byYear.end(); ++it) {
+        QVector<Transaction> merged;
+        if (QFileInfo::exists(partitionPath(it.key())) && !readYear(it.key(), merged)) {
+            return false;   // don't overwrite what we couldn't read
+        }
+        QSet<int> ids;
+        for (const Transaction &trans : merged) {
+            ids.insert(trans.id);
+        }
+        for (const Transaction &trans : it.value()) {
+            if (!ids.contains(trans.id)) merged.append(trans);
+        }
+        if (!writeYear(it.key(), merged)) return false;
+
+        Year year;
+        year.year = it.key();
+        year.count = int(merged.size());
+        for (const Transaction &trans : merged) {
+            year.balance += trans.amount;
+        }
+        auto found = std::find_if(checkpoints.begin(), checkpoints.end(), [&](const Year &y) { return y.year == year.year; });
+        if (found != checkpoints.end()) {
+            *found = year;
+        } else {
+            checkpoints.insert(std::lower_bound(checkpoints.begin(), checkpoints.end(), year,
+                                                [](const Year &a, const Year &b) { return a.year < b.year; }),
+                               year);
+        }
+    }
+
+    this->before = qMax(this->before, before);
+    return writeCheckpoints();
+}
+
+bool LedgerArchive::readYear(int year, QVector<Transaction> &rows) const {
+    MC_TRACE_SCOPE("LedgerArchive::readYear");
+    rows.clear();
+
+    QFile file(partitionPath(year));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not read archive of" << year << ":" << file.errorString();
+        return false;
+    }
+
+    QByteArray json = qUncompress(file.readAll());
+    QJsonDocument doc = QJsonDocument::fromJson(json);
+    if (!doc.isObject()) {
+        qWarning() << "Invalid archive of" << year;
+        return false;
+    }
+
+    QJsonArray jsonArray = doc.object()["transactions"].toArray();
+    rows.reserve(jsonArray.size());
+    for (const auto &value : jsonArray) {
+        Transaction trans = LedgerJournal::fromJson(value.toObject());
+        if (trans.id >= 0) rows.append(trans);
+    }
+    return true;
+}
+
+bool LedgerArchive::writeYear(int year, const QVector<Transaction> &rows) const {
+    QJsonArray jsonArray;
+    for (const Transaction &trans : rows) {
+        jsonArray.append(LedgerJournal::toJson(trans));
+    }
+    QJsonObject root;
+    root["year"] = year;
+    root["transactions"] = jsonArray;
+
+    QSaveFile file(partitionPath(year));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write archive of" << year << ":" << file.errorString();
+        return false;
+    }
+    QByteArray compressed = qCompress(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.write(compressed);
+    if (!file.commit()) {
+        qWarning() << "Could not write archive of" << year << ":" << file.errorString();
+        return false;
+    }
+    MC_COUNT(BytesWritten, compressed.size());
+    return true;
+}
+
+bool LedgerArchive::writeCheckpoints() const {
+    QJsonArray years;
+    for (const Year &year : checkpoints) {
+        QJsonObject obj;
+        obj["year"] = year.year;
+        obj["balanceCents"] = year.balance.cents();
+        obj["count"] = year.count;
+        years.append(obj);
+    }
+    QJsonObject root;
+    root["archivedBefore"] = before;
+    root["years"] = years;
+
+    QSaveFile file(checkpointsPath());
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Could not write archive checkpoints:" << file.errorString();
+        return false;
+    }
+    QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+    file.write(json);
+    if (!file.commit()) {
+        qWarning() << "Could not write archive checkpoints:" << file.errorString();
+        return false;
+    }
+    MC_COUNT(BytesWritten, json.size());
+    return true;
+}
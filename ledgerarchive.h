@@ -0,0 +1,53 @@
+// ledgerarchive.h
+#ifndef LEDGERARCHIVE_H
+#define LEDGERARCHIVE_H
+
+#include <QString>
+#include <QVector>
+
+#include "money.h"
+#include "transaction.h"
+
+// Settled history of a ledger, kept out of its snapshot: one-time
+// transactions from before a cutoff year move into archive/<year>.mca, one
+// zlib-compressed partition per year, and archive/checkpoints.json keeps
+// what each year added to the balance. Only the checkpoints are read when
+// the ledger loads; a partition is decompressed when someone looks at its
+// year (see Ledger::showArchive).
+class LedgerArchive {
+public:
+    struct Year {
+        int year = 0;
+        Money balance;             // sum of the year's archived transactions
+        int count = 0;
+    };
+
+    explicit LedgerArchive(const QString &directory);
+
+    QString checkpointsPath() const;
+    QString partitionPath(int year) const;
+
+    bool load();                   // the checkpoints only; no archive yet is fine
+    const QVector<Year> &years() const { return checkpoints; }   // oldest first
+    bool contains(int year) const;
+    // One-time transactions of the years before this one have all been moved
+    // out (0: nothing archived yet); later edits may still add some
+    int archivedBefore() const { return before; }
+
+    // Moves rows (one-time, dated before year `before`) into their partitions
+    // and rewrites the checkpoints. Merged by id, so running it again over
+    // rows that were already archived changes nothing.
+    bool archive(const QVector<Transaction> &rows, int before);
+
+    bool readYear(int year, QVector<Transaction> &rows) const;
+
+private:
+    bool writeYear(int year, const QVector<Transaction> &rows) const;
+    bool writeCheckpoints() const;
+
+    QString directory;             // the ledger's archive/ folder
+    QVector<Year> checkpoints;
+    int before = 0;
+};
+
+#endif // LEDGERARCHIVE_H
@@ -0,0 +1,301 @@
+// ledgerbenchmark.cpp
+#include "ledgerbenchmark.h"
+#include "balancekernels.h"
+#include "balancetimeline.h"
+#include "eventlistmodel.h"
+#include "ledger.h"
+#include "ledgerjournal.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTextStream>
+#include <QThreadPool>
+
+#include <random>
+
+static const char *const MixNames[5] = { "none", "weekly", "biweekly", "monthly", "everyn" };
+
+// The 30-year forecast scaling runs only for ledgers up to this size
+static const int MaxForecastSize = 100000;
+
+// Rows the event list shows without scrolling
+static const int EventListRows = 20;
+
+// Written once per benchmark so the timed work can't be optimised away
+static volatile qint64 benchmarkSink;
+
+bool LedgerBenchmark::Mix::parse(const QString &text, Mix &mix) {
+    Mix parsed;
+    for (int &weight : parsed.weights) weight = 0;
+
+    for (const QString &part : text.split(',', Qt::SkipEmptyParts)) {
+        QStringList pair = part.split('=');
+        bool ok = false;
+        int weight = pair.size() == 2 ? pair[1].trimmed().toInt(&ok) : 0;
+        if (!ok || weight < 0) return false;
+
+        int type = 0;
+        while (type < 5 && pair[0].trimmed().compare(MixNames[type], Qt::CaseInsensitive) != 0) ++type;
+        if (type == 5) return false;
+        parsed.weights[type] = weight;
+    }
+
+    int total = 0;
+    for (int weight : parsed.weights) total += weight;
+    if (total == 0) return false;
+
+    mix = parsed;
+    return true;
+}
+
+QJsonObject LedgerBenchmark::Mix::toJson() const {
+    QJsonObject obj;
+    for (int type = 0; type < 5; ++type) {
+        obj[MixNames[type]] = weights[type];
+    }
+    return obj;
+}
+
+QVector<Transaction> LedgerBenchmark::syntheticLedger(int count, const Mix &mix, quint32 seed) {
+    std::mt19937 random(seed);
+    std::discrete_distribution<int> recurrence(std::begin(mix.weights), std::end(mix.weights));
+    std::uniform_int_distribution<int> startOffset(0, 3652);          // ten years from 2020
+    std::uniform_int_distribution<qint64> cents(-500000, 500000);    // +-5000.00
+    std::uniform_int_distribution<int> interval(2, 12);
+    std::uniform_int_distribution<int> payee(0, 99);
+
+    const QDate base(2020, 1, 1);
+    QVector<Transaction> transactions;
+    transactions.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        Transaction trans;
+        trans.id = i;
+        trans.startDate = base.addDays(startOffset(random));
+        trans.amount = Money::fromCents(cents(random));
+        trans.recurrence = RecurrenceType(recurrence(random));
+        trans.intervalMonths = (trans.recurrence == RecurrenceType::EveryNMonths) ? interval(random) : 1;
+        trans.description = QString("Payee %1").arg(payee(random));   // repeats, like a real ledger
+        transactions.append(trans);
+    }
+    return transactions;
+}
+
+// The transactions as a bank's CSV export (recurrence is dropped)
+static bool writeStatement(const QString &path, const QVector<Transaction> &transactions) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write" << path << ":" << file.errorString();
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "Date,Description,Amount\n";
+    for (const auto &trans : transactions) {
+        out << trans.startDate.toString(Qt::ISODate) << ",\"" << trans.description << "\","
+            << trans.amount.toString() << '\n';
+    }
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
+
+QJsonObject LedgerBenchmark::run(const QVector<int> &sizes, const Mix &mix, double minSeconds) {
+    const qint64 minNanos = qint64(minSeconds * 1e9);
+    QJsonArray results;
+
+    // Query dates from a year before the first start to five after the last
+    QVector<QDate> dates;
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> offset(-365, 3652 + 5 * 365);
+    for (int i = 0; i < 1024; ++i) {
+        dates.append(QDate(2020, 1, 1).addDays(offset(random)));
+    }
+    auto dateAt = [&](qint64 i) { return dates[int(i & 1023)]; };
+
+    // 1, 2, 4, ... threads, and every core
+    QVector<int> threadCounts;
+    for (int threads = 1; threads < QThread::idealThreadCount(); threads *= 2) {
+        threadCounts.append(threads);
+    }
+    threadCounts.append(qMax(1, QThread::idealThreadCount()));
+
+    for (int size : sizes) {
+        QTemporaryDir directory;
+        if (!directory.isValid()) {
+            qWarning() << "Could not create a temporary ledger folder";
+            break;
+        }
+
+        // Start from a snapshot on disk, the way the app starts
+        {
+            TransactionStore initial;
+            initial.assign(syntheticLedger(size, mix));
+            LedgerJournal(directory.path()).compact(initial, size);
+        }
+
+        qint64 checksum = 0;
+        Ledger ledger(directory.path());
+        results.append(measure("load", size, minNanos, [&](qint64) {
+            ledger.load();
+        }));
+        results.append(measure("save", size, minNanos, [&](qint64) {
+            ledger.save();
+        }));
+
+        // Startup from each snapshot format, whichever one this size would get
+        LedgerJournal written(directory.path());
+        QString snapshot = QFileInfo::exists(written.binarySnapshotPath()) ? written.binarySnapshotPath()
+                                                                           : written.snapshotPath();
+        for (const char *format : { "json", "mcl" }) {
+            QString folder = directory.filePath(format);
+            QDir().mkpath(folder);
+            if (!LedgerJournal::convertSnapshot(snapshot, folder + "/transactions." + format)) continue;
+
+            Ledger formatLedger(folder, true);
+            results.append(measure(QString("startup/%1").arg(format), size, minNanos, [&](qint64) {
+                formatLedger.load();
+                checksum += formatLedger.transactions().size();
+            }));
+            QDir(folder).removeRecursively();
+        }
+
+        const TransactionStore &store = ledger.transactions();
+
+        // The balance labels: one pass over every column
+        results.append(measure("balanceUpTo", size, minNanos, [&](qint64 i) {
+            checksum += store.balanceUpTo(dateAt(i)).cents();
+        }));
+
+        // Which transactions fall on a day (what isTransactionOnDate used to answer)
+        results.append(measure("transactionsOn", size, minNanos, [&](qint64 i) {
+            checksum += ledger.transactionsOn(dateAt(i)).size();
+        }));
+
+        // The event list: switch the model to that day, then format the rows
+        // a view would show
+        EventListModel events(ledger);
+        results.append(measure("eventList", size, minNanos, [&](qint64 i) {
+            events.setDate(dateAt(i));
+            int rows = qMin(events.rowCount(), EventListRows);
+            for (int row = 0; row < rows; ++row) {
+                checksum += events.data(events.index(row)).toString().size();
+            }
+        }));
+
+        // What a calendar repaint asks the engine for: balance and net for the
+        // 42 cells of a page (moneycalendar-widgetbench times the painting)
+        results.append(measure("pagePaint", size, minNanos, [&](qint64 i) {
+            ledger.project(dateAt(i), dateAt(i).addDays(41), [&](const QDate &, Money balance, Money net) {
+                checksum += balance.cents() + net.cents();
+                return true;
+            });
+        }));
+
+        // The kernels for one page, with balances and with nets only (what
+        // BalanceTimeline::rebuild asks for)
+        BalanceKernels::Target targets[BalanceKernels::MaxBatch];
+        Money balances[BalanceKernels::MaxBatch];
+        Money nets[BalanceKernels::MaxBatch];
+        auto pageTargets = [&](qint64 i) {
+            for (int day = 0; day < BalanceKernels::MaxBatch; ++day) {
+                targets[day] = BalanceKernels::Target::fromDate(dateAt(i).addDays(day));
+            }
+        };
+        results.append(measure("kernels/balances", size, minNanos, [&](qint64 i) {
+            pageTargets(i);
+            BalanceKernels::project(store, targets, BalanceKernels::MaxBatch, balances, nets);
+            checksum += balances[0].cents() + nets[0].cents();
+        }));
+        results.append(measure("kernels/nets", size, minNanos, [&](qint64 i) {
+            pageTargets(i);
+            BalanceKernels::projectNets(store, targets, BalanceKernels::MaxBatch, nets);
+            checksum += nets[0].cents();
+        }));
+
+        // Moving to a page outside the cached range: rebuild five months of timeline
+        results.append(measure("pageChange", size, minNanos, [&](qint64 i) {
+            BalanceTimeline timeline;
+            QDate shown = dateAt(i);
+            timeline.rebuild(store, shown.addMonths(-2), shown.addMonths(3).addDays(-1));
+            checksum += timeline.balanceOn(shown).cents();
+        }));
+
+        // Long-range forecast, to see how it scales with the number of
+        // threads: speedup is against the single-threaded run
+        if (size <= MaxForecastSize) {
+            const QDate start(2025, 1, 1);
+            double singleThreaded = 0;
+            for (int threads : threadCounts) {
+                QThreadPool pool;
+                pool.setMaxThreadCount(threads);
+                QJsonObject result = measure(QString("forecast30y/threads:%1").arg(threads), size, minNanos, [&](qint64) {
+                    BalanceTimeline timeline;
+                    timeline.rebuild(store, start, start.addYears(30).addDays(-1), nullptr, &pool);
+                    checksum += timeline.balanceOn(start).cents();
+                });
+                result["threads"] = threads;
+                if (threads == 1) singleThreaded = result["real_time"].toDouble();
+                if (singleThreaded > 0) result["speedup"] = singleThreaded / result["real_time"].toDouble();
+                results.append(result);
+            }
+        }
+
+        // Bulk import of a bank statement with that many rows into an empty
+        // ledger. Every run must add all of them, adding up to the statement's total.
+        QString statement = directory.filePath("statement.csv");
+        QVector<Transaction> rows = syntheticLedger(size, mix, 11);
+        if (writeStatement(statement, rows)) {
+            Money total;
+            QDate last;
+            for (const Transaction &trans : rows) {
+                total += trans.amount;
+                last = qMax(last, trans.startDate);
+            }
+
+            QString error;
+            QJsonObject result = measure("import", size, minNanos, [&](qint64 i) {
+                QString folder = directory.filePath(QString("import%1").arg(i));
+                {
+                    Ledger imported(folder);
+                    imported.load();
+                    Ledger::ImportResult outcome = imported.import(statement);
+                    if (!outcome.ok || outcome.added != size || outcome.rejected != 0) {
+                        error = QString("imported %1 of %2 rows, %3 rejected").arg(outcome.added).arg(size).arg(outcome.rejected);
+                    } else if (imported.balanceOn(last) != total) {
+                        error = QString("balance %1, statement total %2").arg(imported.balanceOn(last).toString(), total.toString());
+                    }
+                    checksum += outcome.added;
+                }
+                QDir(folder).removeRecursively();
+            });
+            if (!error.isEmpty()) {
+                result["error_occurred"] = true;   // Google Benchmark's way of flagging a run
+                result["error_message"] = error;
+            }
+            results.append(result);
+        }
+
+        benchmarkSink = checksum;
+    }
+
+    return document(results, mix, minSeconds);
+}
+
+QJsonObject LedgerBenchmark::document(const QJsonArray &results, const Mix &mix, double minSeconds) {
+    QJsonObject context;
+    context["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    context["instruction_set"] = BalanceKernels::instructionSet();
+    context["min_time"] = minSeconds;
+    context["mix"] = mix.toJson();
+
+    QJsonObject root;
+    root["context"] = context;
+    root["benchmarks"] = results;
+    return root;
+}
@@ -0,0 +1,68 @@
+// ledgerbenchmark.h
+#ifndef LEDGERBENCHMARK_H
+#define LEDGERBENCHMARK_H
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+#include "transaction.h"
+
+// Timing runs over synthetic ledgers, for moneycalendar-cli --benchmark and
+// moneycalendar-widgetbench. The result is a Google Benchmark style JSON
+// document ("context" + a list of "benchmarks" with iterations and real_time)
+// so runs of different releases can be compared with the usual tooling.
+namespace LedgerBenchmark {
+
+// Relative weight of each RecurrenceType in a synthetic ledger
+struct Mix {
+    int weights[5] = { 40, 20, 10, 20, 10 };   // None, Weekly, BiWeekly, Monthly, EveryNMonths
+
+    static bool parse(const QString &text, Mix &mix);   // "none=40,weekly=20,biweekly=10,monthly=20,everyn=10"
+    QJsonObject toJson() const;
+};
+
+// Same seed, same ledger
+QVector<Transaction> syntheticLedger(int count, const Mix &mix, quint32 seed = 1);
+
+// Like Google Benchmark: grow the iteration count until one batch takes at
+// least minNanos, then report the time per iteration of that batch
+template <typename Body>
+QJsonObject measure(const QString &name, int size, qint64 minNanos, Body body) {
+    qint64 iterations = 1;
+    for (;;) {
+        QElapsedTimer timer;
+        timer.start();
+        for (qint64 i = 0; i < iterations; ++i) {
+            body(i);
+        }
+        qint64 elapsed = timer.nsecsElapsed();
+
+        if (elapsed >= minNanos || iterations >= 1000000000) {
+            QJsonObject result;
+            result["name"] = QString("%1/%2").arg(name).arg(size);
+            result["transactions"] = size;
+            result["iterations"] = iterations;
+            result["real_time"] = double(elapsed) / iterations;
+            result["time_unit"] = "ns";
+            return result;
+        }
+
+        // Aim 40% past the target so the next batch is very likely long enough
+        double scale = 1.4 * double(minNanos) / double(qMax<qint64>(elapsed, 1));
+        iterations = qMax(iterations + 1, qint64(iterations * qMin(scale, 10.0)));
+    }
+}
+
+// Every benchmark for every ledger size; each one repeats until it has run
+// for at least minSeconds
+QJsonObject run(const QVector<int> &sizes, const Mix &mix, double minSeconds);
+
+// results as the JSON document run() returns, with the context of this machine
+QJsonObject document(const QJsonArray &results, const Mix &mix, double minSeconds);
+
+} // namespace LedgerBenchmark
+
+#endif // LEDGERBENCHMARK_H
@@ -0,0 +1,158 @@
+// ledgerbinary.cpp
+#include "ledgerbinary.h"
+#include "instrumentation.h"
+#include "recurrence.h"
+#include "transactionstore.h"
+
+#include <QDebug>
+#include <QHash>
+#include <QSaveFile>
+
+#include <cstring>
+
+bool LedgerBinary::isBinaryLedger(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    char magic[4];
+    return file.read(magic, sizeof(magic)) == sizeof(magic)
+           && std::memcmp(magic, Magic, sizeof(magic)) == 0;
+}
+
+bool LedgerBinary::write(const QString &path, const QVector<Transaction> &transactions,
+                         int nextId, qint64 journalSeq) {
+    QVector<Record> records;
+    records.reserve(transactions.size());
+
+    // Repeated descriptions (imported statements are full of them) share one pool entry
+    QString pool;
+    QHash<QString, quint32> pooled;
+
+    for (const auto &trans : transactions) {
+        auto found = pooled.constFind(trans.description);
+        quint32 offset;
+        if (found != pooled.constEnd()) {
+            offset = found.value();
+        } else {
+            offset = quint32(pool.size());
+            pool += trans.description;
+            pooled.insert(trans.description, offset);
+        }
+
+        Record rec = {};
+        rec.julianDay = trans.startDate.isValid() ? qint32(trans.startDate.toJulianDay()) : TransactionStore::NeverDay;
+        rec.id = trans.id;
+        rec.amountCents = trans.amount.cents();
+        int interval = (trans.recurrence == RecurrenceType::EveryNDays) ? trans.intervalDays : trans.intervalMonths;
+        rec.schedule = quint32(trans.recurrence) | (quint32(qBound(0, interval, 0xffff)) << 8)
+                       | (quint32(quint8(qint8(trans.weekOfMonth))) << 24);
+        rec.descriptionOffset = offset;
+        rec.descriptionLength = quint32(trans.description.size());
+        rec.endJulianDay = trans.endDate.isValid() ? qint32(trans.endDate.toJulianDay()) : 0;
+        rec.occurrenceLimit = trans.occurrenceLimit;
+        records.append(rec);
+    }
+
+    FileHeader header = {};
+    std::memcpy(header.magic, Magic, sizeof(header.magic));
+    header.byteOrder = ByteOrderMark;
+    header.version = Version;
+    header.recordCount = quint32(records.size());
+    header.journalSeq = journalSeq;
+    header.nextId = nextId;
+    header.poolLength = quint32(pool.size());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not save transactions:" << file.errorString();
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(records.constData()), records.size() * sizeof(Record));
+    file.write(reinterpret_cast<const char *>(pool.constData()), pool.size() * sizeof(QChar));
+    if (!file.commit()) {
+        qWarning() << "Could not save transactions:" << file.errorString();
+        return false;
+    }
+    MC_COUNT(BytesWritten, sizeof(header) + records.size() * sizeof(Record) + pool.size() * sizeof(QChar));
+    return true;
+}
+
+bool LedgerBinary::read(QFile &file, QVector<Transaction> &transactions, int &nextId, qint64 &journalSeq) {
+    if (!file.isOpen() && !file.open(QIODevice::ReadOnly)) return false;
+
+    qint64 size = file.size();
+    if (size < qint64(sizeof(FileHeader))) return false;
+
+    uchar *data = file.map(0, size);
+    if (!data) {
+        qWarning() << "Could not map transactions file:" << file.errorString();
+        return false;
+    }
+
+    const auto *header = reinterpret_cast<const FileHeader *>(data);
+    qint64 recordSize = (header->version == 1) ? Version1RecordSize : qint64(sizeof(Record));
+    qint64 recordsEnd = qint64(sizeof(FileHeader)) + qint64(header->recordCount) * recordSize;
+    qint64 poolEnd = recordsEnd + qint64(header->poolLength) * qint64(sizeof(QChar));
+
+    if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0
+        || header->byteOrder != ByteOrderMark
+        || header->version < 1 || header->version > Version
+        || poolEnd > size) {
+        qWarning() << "Invalid binary transactions file";
+        file.unmap(data);
+        return false;
+    }
+
+    const uchar *records = data + sizeof(FileHeader);
+    const auto *pool = reinterpret_cast<const QChar *>(data + recordsEnd);
+
+    const int firstRow = int(transactions.size());
+    transactions.reserve(transactions.size() + header->recordCount);
+    for (quint32 i = 0; i < header->recordCount; ++i) {
+        // Older, shorter records read with the newer fields zeroed
+        Record rec = {};
+        std::memcpy(&rec, records + i * recordSize, size_t(recordSize));
+        if (quint64(rec.descriptionOffset) + rec.descriptionLength > header->poolLength) {
+            // Skipping the row would let the next compaction drop it for good
+            qWarning() << "Invalid binary transactions file: record" << i << "runs past the string pool";
+            transactions.resize(firstRow);   // the rows read so far point into the mapping
+            file.unmap(data);
+            return false;
+        }
+
+        Transaction trans;
+        trans.startDate      = (rec.julianDay == TransactionStore::NeverDay) ? QDate() : QDate::fromJulianDay(rec.julianDay);
+        trans.amount         = Money::fromCents(rec.amountCents);
+        trans.recurrence     = static_cast<RecurrenceType>(rec.schedule & 0xff);
+        int interval         = Recurrence::boundedInterval(int((rec.schedule >> 8) & 0xffff));
+        if (trans.recurrence == RecurrenceType::EveryNDays) {
+            trans.intervalDays = interval;
+        } else {
+            trans.intervalMonths = interval;
+        }
+        trans.endDate        = rec.endJulianDay ? QDate::fromJulianDay(rec.endJulianDay) : QDate();
+
+        // Same ranges as LedgerJournal::fromJson, whatever the file says
+        int week             = (header->version == 1) ? 1 : int(qint8(rec.schedule >> 24));
+        trans.weekOfMonth    = (week >= 1 && week <= 4) ? week : -1;
+        trans.occurrenceLimit = qMax(0, rec.occurrenceLimit);
+        trans.id             = rec.id;
+#ifdef Q_OS_WIN
+        // Windows cannot replace a mapped file, so copy and let the mapping go below
+        trans.description    = QString(pool + rec.descriptionOffset, rec.descriptionLength);
+#else
+        trans.description    = QString::fromRawData(pool + rec.descriptionOffset, rec.descriptionLength);
+#endif
+        transactions.append(trans);
+    }
+
+    nextId = header->nextId;
+    journalSeq = header->journalSeq;
+
+#ifdef Q_OS_WIN
+    file.unmap(data);
+    file.close();
+#endif
+    return true;
+}
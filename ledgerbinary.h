@@ -0,0 +1,60 @@
+// ledgerbinary.h
+#ifndef LEDGERBINARY_H
+#define LEDGERBINARY_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include "transaction.h"
+
+// Compact snapshot format for big ledgers: a header, a table of fixed-size
+// records and one shared UTF-16 string pool for the descriptions. It is read
+// through a memory mapping and descriptions are QString::fromRawData views into
+// the pool, so nothing is parsed or copied until a description is displayed.
+// Numbers are stored in host byte order; byteOrder rejects foreign files.
+namespace LedgerBinary {
+
+struct FileHeader {
+    char magic[4];              // "MCLB"
+    quint32 byteOrder;          // ByteOrderMark as written by the host
+    quint32 version;
+    quint32 recordCount;
+    qint64 journalSeq;          // see LedgerJournal
+    qint32 nextId;
+    quint32 poolLength;         // string pool size, in UTF-16 code units
+};
+
+struct Record {
+    qint32 julianDay;           // TransactionStore::NeverDay: no (valid) start date
+    qint32 id;
+    qint64 amountCents;
+    quint32 schedule;           // RecurrenceType | interval << 8 | quint8(weekOfMonth) << 24
+    quint32 descriptionOffset;  // into the string pool, in UTF-16 code units
+    quint32 descriptionLength;
+    qint32 endJulianDay;        // 0: no end date
+    qint32 occurrenceLimit;     // 0: no limit
+    quint32 reserved;
+};
+
+static_assert(sizeof(FileHeader) == 32, "binary ledger header must stay 32 bytes");
+static_assert(sizeof(Record) == 40, "binary ledger record must stay 40 bytes");
+
+// Version 1 records were 32 bytes: the same fields up to descriptionLength
+constexpr quint32 Version1RecordSize = 32;
+
+constexpr char Magic[4] = { 'M', 'C', 'L', 'B' };
+constexpr quint32 ByteOrderMark = 0x01020304;
+constexpr quint32 Version = 2;
+
+bool isBinaryLedger(const QString &path);
+
+bool write(const QString &path, const QVector<Transaction> &transactions, int nextId, qint64 journalSeq);
+
+// Maps `file` and fills `transactions` from it. The descriptions point into the
+// mapping, so the file must stay open (and mapped) while they are in use.
+bool read(QFile &file, QVector<Transaction> &transactions, int &nextId, qint64 &journalSeq);
+
+} // namespace LedgerBinary
+
+#endif // LEDGERBINARY_H
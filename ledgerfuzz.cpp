@@ -0,0 +1,38 @@
+// ledgerfuzz.cpp
+// libFuzzer target, built instead of the command-line tool with
+//
+//   qmake CONFIG+=fuzz && make      (clang; AddressSanitizer and UBSan included)
+//   cli/moneycalendar-fuzz CORPUS_DIR
+//
+// Every input is taken as a JSON snapshot (see LedgerVerifier::checkSnapshot).
+// Crashes and sanitizer reports end the run by themselves; a disagreement
+// between the engine's fast paths aborts, so the fuzzer keeps that input too.
+// moneycalendar-cli --verify FILE replays one without libFuzzer.
+#include "ledgerverifier.h"
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include <cstdio>
+#include <cstdlib>
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv) {
+    Q_UNUSED(argc);
+    Q_UNUSED(argv);
+    // Nearly every input is malformed; thousands of warnings a second would
+    // drown the fuzzer's own output
+    qInstallMessageHandler([](QtMsgType, const QMessageLogContext &, const QString &) {});
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    LedgerVerifier::Report report;
+    LedgerVerifier::checkSnapshot(QByteArray(reinterpret_cast<const char *>(data), qsizetype(size)), report);
+    if (!report.ok()) {
+        for (const QString &failure : report.failures) {
+            fprintf(stderr, "%s\n", qPrintable(failure));
+        }
+        abort();
+    }
+    return 0;
+}
@@ -0,0 +1,433 @@
+// ledgerjournal.cpp
+#include "ledgerjournal.h"
+#include "instrumentation.h"
+#include "ledgerbinary.h"
+#include "recurrence.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QSet>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <utility>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Make sure what was just written survives a crash or power loss
+static bool syncToDisk(QFile &file) {
+    if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+LedgerJournal::LedgerJournal(const QString &directory) : directory(directory) {
+    journalFile.setFileName(journalPath());
+}
+
+LedgerJournal::~LedgerJournal() {
+    if (compacting) {
+        compaction.waitForFinished();
+    }
+}
+
+QString LedgerJournal::snapshotPath() const {
+    return directory + "/transactions.json";
+}
+
+QString LedgerJournal::binarySnapshotPath() const {
+    return directory + "/transactions.mcl";
+}
+
+QString LedgerJournal::journalPath() const {
+    return directory + "/transactions.journal";
+}
+
+QJsonObject LedgerJournal::toJson(const Transaction &trans) {
+    QJsonObject obj;
+    obj["startDate"]     = trans.startDate.toString(Qt::ISODate);
+    obj["description"]   = trans.description;
+    obj["amountCents"]   = trans.amount.cents();
+    obj["recurrence"]    = static_cast<int>(trans.recurrence);
+    obj["intervalMonths"] = trans.intervalMonths;     // important for the new every-N-months feature
+    obj["id"]            = trans.id;
+
+    // Only written when they differ from what older files imply
+    if (trans.recurrence == RecurrenceType::EveryNDays) obj["intervalDays"] = trans.intervalDays;
+    if (trans.recurrence == RecurrenceType::NthWeekday) obj["weekOfMonth"] = trans.weekOfMonth;
+    if (trans.endDate.isValid()) obj["endDate"] = trans.endDate.toString(Qt::ISODate);
+    if (trans.occurrenceLimit > 0) obj["occurrenceLimit"] = trans.occurrenceLimit;
+    return obj;
+}
+
+Transaction LedgerJournal::fromJson(const QJsonObject &obj) {
+    Transaction trans;
+    trans.startDate     = QDate::fromString(obj["startDate"].toString(), Qt::ISODate);
+    trans.description   = obj["description"].toString();
+    // Older files stored a floating point "amount"
+    trans.amount        = obj.contains("amountCents") ? Money::fromCents(obj["amountCents"].toInteger())
+                                                      : Money::fromDouble(obj["amount"].toDouble());
+    // A kind this version doesn't know is kept for whoever wrote it, and never occurs here
+    trans.recurrence    = static_cast<RecurrenceType>(obj["recurrence"].toInt());
+    trans.id            = obj["id"].toInt(-1);
+    trans.endDate       = QDate::fromString(obj["endDate"].toString(), Qt::ISODate);
+
+    // Whatever the file says, the rest stays in the ranges the engine and the
+    // binary format handle, with the meaning the engine gives anything outside
+    trans.intervalMonths = Recurrence::boundedInterval(obj["intervalMonths"].toInt(1));   // default 1 if missing
+    trans.intervalDays  = Recurrence::boundedInterval(obj["intervalDays"].toInt(1));
+    int week            = obj["weekOfMonth"].toInt(1);
+    trans.weekOfMonth   = (week >= 1 && week <= 4) ? week : -1;
+    trans.occurrenceLimit = qMax(0, obj["occurrenceLimit"].toInt(0));
+    return trans;
+}
+
+bool LedgerJournal::readSnapshot(const QString &path, QFile &mapping, QVector<Transaction> &transactions,
+                                 int &nextId, qint64 &seq) {
+    if (LedgerBinary::isBinaryLedger(path)) {
+        mapping.setFileName(path);
+        return LedgerBinary::read(mapping, transactions, nextId, seq);
+    }
+
+    QFile snapshot(path);
+    if (!snapshot.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+    return parseSnapshot(snapshot.readAll(), transactions, nextId, seq);
+}
+
+bool LedgerJournal::parseSnapshot(const QByteArray &json, QVector<Transaction> &transactions,
+                                  int &nextId, qint64 &seq) {
+    QJsonDocument doc = QJsonDocument::fromJson(json);
+    if (doc.isNull() || !doc.isObject()) {
+        qWarning() << "Invalid JSON in transactions file";
+        return false;
+    }
+
+    QJsonObject root = doc.object();
+    nextId = root["nextId"].toInt(0);
+    seq = root["journalSeq"].toInteger(0);
+
+    QJsonArray jsonArray = root["transactions"].toArray();
+    transactions.reserve(jsonArray.size());
+    for (const auto &val : jsonArray) {
+        if (!val.isObject()) continue;
+        transactions.append(fromJson(val.toObject()));
+    }
+    return true;
+}
+
+bool LedgerJournal::load(QVector<Transaction> &transactions, int &nextId, bool readOnly) {
+    // The compaction's copy of the store still reads descriptions from the mapping
+    if (compacting) {
+        compaction.waitForFinished();
+        finishCompaction();
+    }
+
+    transactions.clear();
+    nextId = 0;
+    lastSeq = 0;
+    unreadable = false;
+    mappedSnapshot.close();   // a reload maps the current file, not the one loaded last time
+
+    // Both formats only exist together if we crashed while switching; the newer one wins
+    QFileInfo json(snapshotPath());
+    QFileInfo binary(binarySnapshotPath());
+    bool useBinary = binary.exists() && (!json.exists() || binary.lastModified() >= json.lastModified());
+
+    // first run → no file yet, that's fine
+    QString path = useBinary ? binary.filePath() : json.filePath();
+    if (QFileInfo::exists(path)) {
+        QFile plain;
+        if (!readSnapshot(path, useBinary ? mappedSnapshot : plain, transactions, nextId, lastSeq)) {
+            // Carrying on with just the journal would let the next compaction
+            // replace the whole ledger with the edits made since the snapshot
+            qWarning() << "Could not read snapshot" << path << "- not writing to" << directory;
+            unreadable = true;
+            journalFile.close();
+            mappedSnapshot.close();
+            transactions.clear();
+            nextId = 0;
+            lastSeq = 0;
+            return false;
+        }
+    }
+
+    repairIds(transactions, nextId);
+
+    // Replay whatever happened after the snapshot was taken
+    qint64 validBytes = 0;
+    QFile log(journalPath());
+    if (log.open(QIODevice::ReadOnly)) {
+        while (!log.atEnd()) {
+            QByteArray line = log.readLine();
+            if (!line.endsWith('\n')) break;   // torn by a crash mid-append
+            validBytes += line.size();
+
+            QJsonObject record = QJsonDocument::fromJson(line).object();
+            if (record.isEmpty()) {
+                qWarning() << "Skipping unreadable journal record";
+                continue;
+            }
+
+            qint64 seq = record["seq"].toInteger(0);
+            if (seq <= lastSeq) continue;   // already part of the snapshot
+            lastSeq = seq;
+
+            QString op = record["op"].toString();
+            if (op == "add") {
+                Transaction trans = fromJson(record["transaction"].toObject());
+                if (trans.id < 0) continue;
+                nextId = qMax(nextId, trans.id + 1);
+                transactions.append(trans);
+            } else if (op == "addMany") {
+                for (const auto &value : record["transactions"].toArray()) {
+                    Transaction trans = fromJson(value.toObject());
+                    if (trans.id < 0) continue;
+                    nextId = qMax(nextId, trans.id + 1);
+                    transactions.append(trans);
+                }
+            } else if (op == "delete") {
+                QSet<int> ids;
+                for (const auto &id : record["ids"].toArray()) {
+                    ids.insert(id.toInt());
+                }
+                transactions.erase(std::remove_if(transactions.begin(), transactions.end(),
+                                                  [&](const Transaction &t) { return ids.contains(t.id); }),
+                                   transactions.end());
+            }
+        }
+
+        // Cut the torn tail off so the next record starts on its own line
+        if (!readOnly && log.size() > validBytes) {
+            log.close();
+            QFile::resize(journalPath(), validBytes);
+        }
+    }
+
+    journalBytes = validBytes;
+    return readOnly || openForAppend();
+}
+
+bool LedgerJournal::loadSnapshot(const QString &path, QVector<Transaction> &transactions, int &nextId) {
+    // As in load(), before the mapping goes
+    if (compacting) {
+        compaction.waitForFinished();
+        finishCompaction();
+    }
+
+    transactions.clear();
+    nextId = 0;
+    lastSeq = 0;
+    mappedSnapshot.close();
+
+    if (!readSnapshot(path, mappedSnapshot, transactions, nextId, lastSeq)) {
+        return false;
+    }
+    repairIds(transactions, nextId);
+    return true;
+}
+
+// Safety: assign new ID if corrupted/missing
+void LedgerJournal::repairIds(QVector<Transaction> &transactions, int &nextId) {
+    for (const auto &trans : std::as_const(transactions)) {
+        if (trans.id >= 0) nextId = qMax(nextId, trans.id + 1);
+    }
+    for (auto &trans : transactions) {
+        if (trans.id < 0) trans.id = nextId++;
+    }
+}
+
+bool LedgerJournal::openForAppend() {
+    journalFile.close();
+    QDir().mkpath(directory);   // make sure folder exists
+
+    if (!journalFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Could not open journal:" << journalFile.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool LedgerJournal::appendAdd(const Transaction &trans) {
+    QJsonObject record;
+    record["op"] = "add";
+    record["transaction"] = toJson(trans);
+    return appendRecord(record);
+}
+
+bool LedgerJournal::appendAdds(const QVector<Transaction> &transactions) {
+    QJsonArray array;
+    for (const auto &trans : transactions) {
+        array.append(toJson(trans));
+    }
+
+    QJsonObject record;
+    record["op"] = "addMany";
+    record["transactions"] = array;
+    return appendRecord(record);
+}
+
+bool LedgerJournal::appendDelete(const QVector<int> &ids) {
+    QJsonArray idArray;
+    for (int id : ids) {
+        idArray.append(id);
+    }
+
+    QJsonObject record;
+    record["op"] = "delete";
+    record["ids"] = idArray;
+    return appendRecord(record);
+}
+
+bool LedgerJournal::appendRecord(QJsonObject record) {
+    MC_TRACE_SCOPE("LedgerJournal::appendRecord");
+    if (unreadable) return false;
+    finishCompaction();
+    if (!journalFile.isOpen() && !openForAppend()) return false;
+
+    record["seq"] = ++lastSeq;
+    QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n';
+
+    if (journalFile.write(line) != line.size() || !syncToDisk(journalFile)) {
+        qWarning() << "Could not append to journal:" << journalFile.errorString();
+        return false;
+    }
+    journalBytes += line.size();
+    MC_COUNT(BytesWritten, line.size());
+    return true;
+}
+
+void LedgerJournal::compactInBackground(const TransactionStore &store, int nextId) {
+    if (unreadable) return;
+    finishCompaction();
+    if (compacting) return;   // previous snapshot is still being written
+
+    // The store's columns are implicitly shared, so the copy handed over is cheap
+    compacting = true;
+    compactingSeq = lastSeq;
+    compaction = QtConcurrent::run(&LedgerJournal::writeCompactedSnapshot,
+                                   directory, store, nextId, lastSeq);
+}
+
+bool LedgerJournal::compact(const TransactionStore &store, int nextId) {
+    if (unreadable) {
+        qWarning() << "Could not save transactions: the snapshot in" << directory << "is unreadable";
+        return false;
+    }
+    if (compacting) {
+        compaction.waitForFinished();
+        finishCompaction();
+    }
+
+    if (!writeCompactedSnapshot(directory, store, nextId, lastSeq)) return false;
+    return trimJournal(lastSeq);
+}
+
+void LedgerJournal::finishCompaction() {
+    if (!compacting || !compaction.isFinished()) return;
+
+    compacting = false;
+    if (compaction.result()) {
+        trimJournal(compactingSeq);
+    }
+}
+
+bool LedgerJournal::trimJournal(qint64 upToSeq) {
+    MC_TRACE_SCOPE("LedgerJournal::trimJournal");
+    journalFile.close();
+
+    // Keep only records newer than the snapshot (edits made while it was written)
+    QByteArray kept;
+    QFile log(journalPath());
+    if (log.open(QIODevice::ReadOnly)) {
+        while (!log.atEnd()) {
+            QByteArray line = log.readLine();
+            if (QJsonDocument::fromJson(line).object().value("seq").toInteger(0) > upToSeq) {
+                kept += line;
+            }
+        }
+        log.close();
+    }
+
+    QSaveFile file(journalPath());
+    if (!file.open(QIODevice::WriteOnly) || file.write(kept) != kept.size() || !file.commit()) {
+        qWarning() << "Could not trim journal:" << file.errorString();
+        openForAppend();
+        return false;
+    }
+
+    journalBytes = kept.size();
+    MC_COUNT(BytesWritten, kept.size());
+    return openForAppend();
+}
+
+bool LedgerJournal::writeCompactedSnapshot(const QString &directory, const TransactionStore &store,
+                                           int nextId, qint64 seq) {
+    // Small ledgers stay human-readable JSON, big ones switch to the binary format
+    bool binary = store.size() >= BinarySnapshotThreshold;
+    QString path = directory + (binary ? "/transactions.mcl" : "/transactions.json");
+    QString stale = directory + (binary ? "/transactions.json" : "/transactions.mcl");
+
+    if (!writeSnapshot(path, store.toVector(), nextId, seq)) return false;
+    if (QFileInfo::exists(stale)) {
+        QFile::remove(stale);
+    }
+    return true;
+}
+
+bool LedgerJournal::convertSnapshot(const QString &fromPath, const QString &toPath) {
+    QVector<Transaction> transactions;
+    QFile mapping;
+    int nextId = 0;
+    qint64 seq = 0;
+
+    if (!readSnapshot(fromPath, mapping, transactions, nextId, seq)) return false;
+    return writeSnapshot(toPath, transactions, nextId, seq);
+}
+
+bool LedgerJournal::writeSnapshot(const QString &path, const QVector<Transaction> &transactions,
+                                  int nextId, qint64 seq) {
+    MC_TRACE_SCOPE("LedgerJournal::writeSnapshot");
+    QDir().mkpath(QFileInfo(path).absolutePath());   // make sure folder exists
+
+    if (path.endsWith(".mcl")) {
+        return LedgerBinary::write(path, transactions, nextId, seq);
+    }
+
+    QJsonArray jsonArray;
+    for (const auto &trans : transactions) {
+        jsonArray.append(toJson(trans));
+    }
+
+    QJsonObject root;
+    root["transactions"] = jsonArray;
+    root["nextId"]       = nextId;
+    root["journalSeq"]   = seq;       // journal records up to here are folded in
+
+    // QSaveFile only replaces the old snapshot once the new one is fully written
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Could not save transactions:" << file.errorString();
+        return false;
+    }
+    QByteArray json = QJsonDocument(root).toJson(QJsonDocument::Indented);
+    file.write(json);
+    if (!file.commit()) {
+        qWarning() << "Could not save transactions:" << file.errorString();
+        return false;
+    }
+    MC_COUNT(BytesWritten, json.size());
+    return true;
+}
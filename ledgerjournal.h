@@ -0,0 +1,89 @@
+// ledgerjournal.h
+#ifndef LEDGERJOURNAL_H
+#define LEDGERJOURNAL_H
+
+#include <QFile>
+#include <QFuture>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+#include "transactionstore.h"
+
+// Persists the ledger as a snapshot (transactions.json, or transactions.mcl
+// once it is big enough to be worth the binary format, see ledgerbinary.h)
+// plus an append-only journal (transactions.journal) of the adds/deletes made since. Each edit
+// appends and fsyncs one compact line; once the journal grows past
+// CompactionThreshold a fresh snapshot is written on a worker thread and the
+// journal is trimmed. Every record carries a sequence number and the snapshot
+// remembers the last one it contains, so a crash at any point replays cleanly.
+class LedgerJournal {
+public:
+    explicit LedgerJournal(const QString &directory);
+    ~LedgerJournal();
+
+    QString snapshotPath() const;          // JSON snapshot
+    QString binarySnapshotPath() const;    // binary snapshot
+    QString journalPath() const;
+
+    // Snapshot + replay of the journal on top of it. Descriptions from a binary
+    // snapshot live in its mapping, so keep the journal around as long as the
+    // transactions, and drop them before loading again. readOnly leaves the files exactly as found
+    // (no torn-tail repair, journal not opened for appending). A snapshot that
+    // exists but can't be read fails the load, and nothing is written to this
+    // folder afterwards (see snapshotUnreadable).
+    bool load(QVector<Transaction> &transactions, int &nextId, bool readOnly = false);
+    bool snapshotUnreadable() const { return unreadable; }
+
+    // Just one snapshot file (either format), no journal; for read-only use
+    bool loadSnapshot(const QString &path, QVector<Transaction> &transactions, int &nextId);
+
+    bool appendAdd(const Transaction &trans);
+    bool appendAdds(const QVector<Transaction> &transactions);   // one record: all or none replay
+    bool appendDelete(const QVector<int> &ids);
+
+    bool needsCompaction() const { return journalBytes >= CompactionThreshold; }
+    void compactInBackground(const TransactionStore &store, int nextId);
+    bool compact(const TransactionStore &store, int nextId);   // blocking, e.g. on exit
+
+    static QJsonObject toJson(const Transaction &trans);
+    static Transaction fromJson(const QJsonObject &obj);
+    // The transactions of a JSON snapshot, e.g. one that isn't a file
+    static bool parseSnapshot(const QByteArray &json, QVector<Transaction> &transactions,
+                              int &nextId, qint64 &seq);
+
+    // Rewrites a snapshot in the other format; the format of each side is
+    // picked by its extension (.mcl = binary, anything else = JSON)
+    static bool convertSnapshot(const QString &fromPath, const QString &toPath);
+
+    static constexpr qint64 CompactionThreshold = 1024 * 1024;
+    static constexpr int BinarySnapshotThreshold = 10000;   // transactions
+
+private:
+    bool openForAppend();
+    bool appendRecord(QJsonObject record);
+    void finishCompaction();
+    bool trimJournal(qint64 upToSeq);
+
+    static void repairIds(QVector<Transaction> &transactions, int &nextId);
+
+    static bool readSnapshot(const QString &path, QFile &mapping, QVector<Transaction> &transactions,
+                             int &nextId, qint64 &seq);
+    static bool writeSnapshot(const QString &path, const QVector<Transaction> &transactions,
+                              int nextId, qint64 seq);
+    static bool writeCompactedSnapshot(const QString &directory, const TransactionStore &store,
+                                       int nextId, qint64 seq);
+
+    QString directory;
+    QFile mappedSnapshot;          // binary snapshot the descriptions point into
+    QFile journalFile;
+    qint64 journalBytes = 0;
+    qint64 lastSeq = 0;            // sequence number of the newest record
+    bool unreadable = false;       // last load() found a snapshot it couldn't read
+
+    QFuture<bool> compaction;      // background snapshot write, if any
+    bool compacting = false;
+    qint64 compactingSeq = 0;      // lastSeq included in that snapshot
+};
+
+#endif // LEDGERJOURNAL_H
@@ -0,0 +1,489 @@
+// ledgerverifier.cpp
+#include "ledgerverifier.h"
+#include "balancekernels.h"
+#include "balancetimeline.h"
+#include "ledgerbinary.h"
+#include "ledgerjournal.h"
+#include "occurrenceindex.h"
+#include "recurrence.h"
+#include "transactionstore.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QSet>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <limits>
+#include <random>
+
+// Amounts stay below this in the random ledgers, so no sum saturates and the
+// order the fast paths add things up in can't matter
+static const qint64 MaxRandomCents = qint64(1) << 36;
+
+// Fuzz inputs are only checked against the reference up to this many rows,
+// and for dates this close to every start, so one input stays fast
+static const int MaxReferenceRows = 64;
+static const int MaxReferenceDays = 4000;
+
+// Dates per ledger that every fast path is asked about
+static const int CheckDates = 24;
+
+void LedgerVerifier::Report::fail(const QString &what) {
+    if (failures.size() < MaxFailures) failures.append(what);
+}
+
+QJsonObject LedgerVerifier::Report::toJson() const {
+    QJsonObject obj;
+    obj["ledgers"] = ledgers;
+    obj["checks"] = double(checks);
+    obj["instructionSet"] = QString::fromLatin1(BalanceKernels::instructionSet());
+    obj["failures"] = QJsonArray::fromStringList(failures);
+    obj["ok"] = ok();
+    return obj;
+}
+
+// --- Reference ---------------------------------------------------------------
+
+static int monthsBetween(const QDate &from, const QDate &to) {
+    return (to.year() - from.year()) * 12 + to.month() - from.month();
+}
+
+// Out of range intervals count as the nearest end, see Recurrence::MaxInterval
+static int referenceInterval(int interval) {
+    return qBound(1, interval, Recurrence::MaxInterval);
+}
+
+// Monthly always means every month, whatever intervalMonths says
+static int referenceMonths(const Transaction &trans) {
+    return (trans.recurrence == RecurrenceType::Monthly) ? 1 : referenceInterval(trans.intervalMonths);
+}
+
+static bool isWeekday(const QDate &date) {
+    return date.dayOfWeek() <= 5;
+}
+
+// On date, ignoring the end date and the occurrence limit
+static bool referenceScheduledOn(const Transaction &trans, const QDate &date) {
+    const QDate &start = trans.startDate;
+    if (!start.isValid() || !date.isValid() || date < start) return false;
+    qint64 days = start.daysTo(date);
+    int months = monthsBetween(start, date);
+
+    switch (trans.recurrence) {
+    case RecurrenceType::None:
+        return days == 0;
+    case RecurrenceType::Weekly:
+        return days % 7 == 0;
+    case RecurrenceType::BiWeekly:
+        return days % 14 == 0;
+    case RecurrenceType::EveryNDays:
+        return days % referenceInterval(trans.intervalDays) == 0;
+    case RecurrenceType::Monthly:
+    case RecurrenceType::EveryNMonths:
+    {
+        // Stepped with addMonths, so a day a short month clamped stays clamped
+        QDate step = start;
+        while (step < date) step = step.addMonths(referenceMonths(trans));
+        return step == date;
+    }
+    case RecurrenceType::NthWeekday:
+    {
+        if (months % referenceInterval(trans.intervalMonths) != 0 || date.dayOfWeek() != start.dayOfWeek()) return false;
+        bool last = trans.weekOfMonth < 1 || trans.weekOfMonth > 4;   // -1, or anything nonsensical
+        return last ? date.day() + 7 > date.daysInMonth() : (date.day() - 1) / 7 + 1 == trans.weekOfMonth;
+    }
+    case RecurrenceType::LastBusinessDay:
+    {
+        if (months % referenceInterval(trans.intervalMonths) != 0 || !isWeekday(date)) return false;
+        for (QDate later = date.addDays(1); later.month() == date.month(); later = later.addDays(1)) {
+            if (isWeekday(later)) return false;
+        }
+        return true;
+    }
+    }
+    return false;   // a kind this version doesn't know never happens
+}
+
+int LedgerVerifier::referenceCountUpTo(const Transaction &trans, const QDate &date) {
+    if (!trans.startDate.isValid() || !date.isValid()) return 0;
+    QDate last = trans.endDate.isValid() ? qMin(date, trans.endDate) : date;
+
+    int count = 0;
+    if (trans.recurrence == RecurrenceType::Monthly || trans.recurrence == RecurrenceType::EveryNMonths) {
+        for (QDate step = trans.startDate; step <= last; step = step.addMonths(referenceMonths(trans))) {
+            ++count;
+            if (trans.occurrenceLimit > 0 && count == trans.occurrenceLimit) break;
+        }
+        return count;
+    }
+    for (QDate day = trans.startDate; day <= last; day = day.addDays(1)) {
+        if (referenceScheduledOn(trans, day)) ++count;
+        if (trans.occurrenceLimit > 0 && count == trans.occurrenceLimit) break;
+    }
+    return count;
+}
+
+bool LedgerVerifier::referenceOccursOn(const Transaction &trans, const QDate &date) {
+    if (!referenceScheduledOn(trans, date)) return false;
+    if (trans.endDate.isValid() && date > trans.endDate) return false;
+    return trans.occurrenceLimit <= 0 || referenceCountUpTo(trans, date.addDays(-1)) < trans.occurrenceLimit;
+}
+
+Money LedgerVerifier::referenceBalance(const QVector<Transaction> &transactions, const QDate &date) {
+    Money balance;
+    for (const Transaction &trans : transactions) {
+        balance += trans.amount * referenceCountUpTo(trans, date);
+    }
+    return balance;
+}
+
+static Money referenceNet(const QVector<Transaction> &transactions, const QDate &date) {
+    Money net;
+    for (const Transaction &trans : transactions) {
+        if (LedgerVerifier::referenceOccursOn(trans, date)) net += trans.amount;
+    }
+    return net;
+}
+
+static QVector<int> referenceIdsOn(const QVector<Transaction> &transactions, const QDate &date) {
+    QVector<int> ids;
+    for (const Transaction &trans : transactions) {
+        if (LedgerVerifier::referenceOccursOn(trans, date)) ids.append(trans.id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+// --- Random ledgers ----------------------------------------------------------
+
+namespace {
+
+template <typename T, int N>
+T pick(std::mt19937 &random, const T (&values)[N]) {
+    return values[random() % N];
+}
+
+int between(std::mt19937 &random, int low, int high) {
+    return low + int(random() % quint32(high - low + 1));
+}
+
+QDate randomDate(std::mt19937 &random, const QDate &around, int spread) {
+    QDate date = around.addDays(between(random, -spread, spread));
+    switch (random() % 6) {
+    case 0: return QDate(date.year(), date.month(), date.daysInMonth());   // month end
+    case 1: return QDate(date.year(), date.month(), qMin(28 + between(random, 0, 3), date.daysInMonth()));
+    case 2: return QDate(date.year() - date.year() % 4, 2, 29);            // a leap day (or invalid in 1900-like years)
+    default: return date;
+    }
+}
+
+Transaction randomTransaction(std::mt19937 &random, const QDate &around) {
+    static const int intervals[] = { -3, 0, 1, 1, 2, 3, 4, 6, 12, 13 };
+    static const int dayIntervals[] = { -1, 0, 1, 2, 7, 10, 14, 28, 30, 91 };
+    static const int weeks[] = { -2, -1, 0, 1, 2, 3, 4, 5 };
+    static const int limits[] = { -1, 0, 1, 2, 3, 12 };
+
+    Transaction trans;
+    trans.startDate = (random() % 40 == 0) ? QDate() : randomDate(random, around, 800);
+    trans.description = QString("row %1").arg(random() % 1000);
+    trans.amount = Money::fromCents(qint64(random() % quint64(MaxRandomCents)) - MaxRandomCents / 2);
+
+    int kind = between(random, 0, 8);   // 8: a kind from some later version
+    trans.recurrence = static_cast<RecurrenceType>(kind == 8 ? between(random, 8, 40) : kind);
+    trans.intervalMonths = (random() % 4 == 0) ? between(random, 1, 40) : pick(random, intervals);
+    trans.intervalDays = (random() % 4 == 0) ? between(random, 1, 400) : pick(random, dayIntervals);
+    trans.weekOfMonth = pick(random, weeks);
+    if (random() % 4 == 0 && trans.startDate.isValid()) trans.endDate = trans.startDate.addDays(between(random, -10, 700));
+    if (random() % 4 == 0) trans.occurrenceLimit = pick(random, limits);
+    return trans;
+}
+
+// The fast paths under test, built over one ledger
+struct Engine {
+    TransactionStore store;
+    OccurrenceIndex index;
+
+    explicit Engine(const QVector<Transaction> &transactions) {
+        store.assign(transactions);
+        index.rebuild(store);
+    }
+};
+
+QString describeRow(const Transaction &trans) {
+    return QString("id %1 start %2 kind %3 months %4 days %5 week %6 end %7 limit %8")
+        .arg(trans.id).arg(trans.startDate.toString(Qt::ISODate)).arg(int(trans.recurrence))
+        .arg(trans.intervalMonths).arg(trans.intervalDays).arg(trans.weekOfMonth)
+        .arg(trans.endDate.toString(Qt::ISODate)).arg(trans.occurrenceLimit);
+}
+
+// Balances and nets from every fast path against the expected ones
+void compareBalances(const char *label, const Engine &engine, const QVector<QDate> &dates,
+                     const QVector<Money> &balances, const QVector<Money> &nets,
+                     LedgerVerifier::Report &report) {
+    BalanceKernels::Target targets[BalanceKernels::MaxBatch];
+    Money kernelBalances[BalanceKernels::MaxBatch];
+    Money kernelNets[BalanceKernels::MaxBatch];
+    Money netsOnly[BalanceKernels::MaxBatch];
+    int count = int(qMin<qsizetype>(dates.size(), BalanceKernels::MaxBatch));
+    for (int i = 0; i < count; ++i) {
+        targets[i] = BalanceKernels::Target::fromDate(dates[i]);
+    }
+    BalanceKernels::project(engine.store, targets, count, kernelBalances, kernelNets);
+    BalanceKernels::projectNets(engine.store, targets, count, netsOnly);
+
+    for (int i = 0; i < dates.size(); ++i) {
+        QString day = QString("%1 %2: ").arg(QString::fromLatin1(label), dates[i].toString(Qt::ISODate));
+        Money expected = balances[i];
+        if (i < count && kernelBalances[i] != expected) {
+            report.fail(day + "kernel balance " + kernelBalances[i].toString() + " != " + expected.toString());
+        }
+        if (i < count && kernelNets[i] != nets[i]) {
+            report.fail(day + "kernel net " + kernelNets[i].toString() + " != " + nets[i].toString());
+        }
+        if (i < count && netsOnly[i] != nets[i]) {
+            report.fail(day + "nets-only kernel " + netsOnly[i].toString() + " != " + nets[i].toString());
+        }
+        if (engine.store.balanceUpTo(dates[i]) != expected) {
+            report.fail(day + "store balance " + engine.store.balanceUpTo(dates[i]).toString() + " != " + expected.toString());
+        }
+        if (engine.store.netOn(dates[i]) != nets[i]) {
+            report.fail(day + "store net " + engine.store.netOn(dates[i]).toString() + " != " + nets[i].toString());
+        }
+        if (engine.index.netAmountOn(dates[i]) != nets[i]) {
+            report.fail(day + "index net " + engine.index.netAmountOn(dates[i]).toString() + " != " + nets[i].toString());
+        }
+        report.checks += 6;
+    }
+}
+
+QVector<QDate> checkDates(std::mt19937 &random, const QDate &around) {
+    QVector<QDate> dates;
+    for (int i = 0; i < CheckDates; ++i) {
+        QDate date = randomDate(random, around, 900);
+        if (date.isValid()) dates.append(date);
+    }
+    return dates;
+}
+
+// Everything for one ledger with a reference answer
+void checkLedger(QVector<Transaction> transactions, std::mt19937 &random, const QDate &around,
+                 LedgerVerifier::Report &report) {
+    using namespace LedgerVerifier;
+    QVector<QDate> dates = checkDates(random, around);
+
+    QVector<Money> balances, nets;
+    for (const QDate &date : dates) {
+        balances.append(referenceBalance(transactions, date));
+        nets.append(referenceNet(transactions, date));
+    }
+
+    Engine engine(transactions);
+    compareBalances("columns", engine, dates, balances, nets, report);
+
+    // What the event list shows, and the per-row counts
+    for (const QDate &date : dates) {
+        QVector<int> ids = engine.index.transactionsOn(date);
+        if (ids != referenceIdsOn(transactions, date)) {
+            report.fail(QString("index %1: ids differ").arg(date.toString(Qt::ISODate)));
+        }
+        ++report.checks;
+    }
+    for (const Transaction &trans : transactions) {
+        const QDate &date = dates[random() % dates.size()];
+        int expected = referenceCountUpTo(trans, date);
+        if (Recurrence::occurrencesUpTo(trans, date) != expected) {
+            report.fail(QString("rule %1 up to %2: %3 != %4").arg(describeRow(trans), date.toString(Qt::ISODate))
+                            .arg(Recurrence::occurrencesUpTo(trans, date)).arg(expected));
+        }
+        ++report.checks;
+    }
+
+    // The store gives back equivalent schedules, and so does JSON
+    QVector<Transaction> stored = engine.store.toVector();
+    QVector<Transaction> json;
+    for (const Transaction &trans : transactions) {
+        json.append(LedgerJournal::fromJson(LedgerJournal::toJson(trans)));
+    }
+    for (const QDate &date : dates) {
+        if (referenceBalance(stored, date) != referenceBalance(transactions, date)) {
+            report.fail(QString("store round trip %1: balances differ").arg(date.toString(Qt::ISODate)));
+        }
+        if (referenceBalance(json, date) != referenceBalance(transactions, date)) {
+            report.fail(QString("JSON round trip %1: balances differ").arg(date.toString(Qt::ISODate)));
+        }
+        report.checks += 2;
+    }
+
+    // A timeline, then a few single edits applied as deltas
+    QDate from = around.addDays(-120);
+    QDate to = around.addDays(120);
+    BalanceTimeline timeline;
+    timeline.rebuild(engine.store, from, to);
+    for (int edit = 0; edit < 6; ++edit) {
+        if (edit % 2 == 0 && !transactions.isEmpty()) {
+            int i = int(random() % transactions.size());
+            timeline.apply(transactions[i], -1);
+            engine.store.remove(transactions[i].id);
+            transactions.removeAt(i);
+        } else {
+            Transaction trans = randomTransaction(random, around);
+            trans.id = transactions.isEmpty() ? 0 : std::max_element(transactions.begin(), transactions.end(),
+                [](const Transaction &a, const Transaction &b) { return a.id < b.id; })->id + 1;
+            engine.store.add(trans);
+            timeline.apply(trans, 1);
+            transactions.append(trans);
+        }
+    }
+    for (int i = 0; i < 8; ++i) {
+        QDate date = from.addDays(random() % (from.daysTo(to) + 1));
+        if (timeline.balanceOn(date) != referenceBalance(transactions, date)) {
+            report.fail(QString("timeline after edits %1: %2 != %3").arg(date.toString(Qt::ISODate),
+                timeline.balanceOn(date).toString(), referenceBalance(transactions, date).toString()));
+        }
+        if (timeline.netOn(date) != referenceNet(transactions, date)) {
+            report.fail(QString("timeline net after edits %1").arg(date.toString(Qt::ISODate)));
+        }
+        report.checks += 2;
+    }
+}
+
+// The binary snapshot format, written and mapped back in
+void checkBinary(const QVector<Transaction> &transactions, const QVector<QDate> &dates,
+                 LedgerVerifier::Report &report) {
+    QTemporaryDir folder;
+    if (!folder.isValid()) return;
+    QString path = folder.filePath("ledger.mcl");
+    if (!LedgerBinary::write(path, transactions, int(transactions.size()), 0)) {
+        report.fail("binary snapshot: could not write");
+        return;
+    }
+
+    QFile file(path);
+    QVector<Transaction> loaded;
+    int nextId = 0;
+    qint64 seq = 0;
+    if (!LedgerBinary::read(file, loaded, nextId, seq)) {
+        report.fail("binary snapshot: could not read back");
+        return;
+    }
+    if (loaded.size() != transactions.size()) {
+        report.fail(QString("binary round trip: %1 rows read back, %2 written").arg(loaded.size()).arg(transactions.size()));
+        return;
+    }
+
+    // Row for row what a JSON snapshot gives back, out-of-range fields included
+    for (int i = 0; i < loaded.size(); ++i) {
+        Transaction expected = LedgerJournal::fromJson(LedgerJournal::toJson(transactions[i]));
+        const Transaction &trans = loaded[i];
+        int interval = (trans.recurrence == RecurrenceType::EveryNDays) ? trans.intervalDays : trans.intervalMonths;
+        int expectedInterval = (trans.recurrence == RecurrenceType::EveryNDays) ? expected.intervalDays
+                                                                                : expected.intervalMonths;
+        bool weekUsed = trans.recurrence == RecurrenceType::NthWeekday;
+        if (trans.id != expected.id || trans.amount != expected.amount || trans.recurrence != expected.recurrence
+            || trans.startDate != expected.startDate || trans.endDate != expected.endDate
+            || interval != expectedInterval || (weekUsed && trans.weekOfMonth != expected.weekOfMonth)
+            || trans.occurrenceLimit != expected.occurrenceLimit || trans.description != expected.description) {
+            report.fail("binary round trip: " + describeRow(trans) + " != JSON " + describeRow(expected));
+        }
+        ++report.checks;
+    }
+    for (const QDate &date : dates) {
+        if (LedgerVerifier::referenceBalance(loaded, date) != LedgerVerifier::referenceBalance(transactions, date)) {
+            report.fail(QString("binary round trip %1: balances differ").arg(date.toString(Qt::ISODate)));
+        }
+        ++report.checks;
+    }
+}
+
+} // namespace
+
+QVector<Transaction> LedgerVerifier::randomLedger(quint32 seed, int count, const QDate &around) {
+    std::mt19937 random(seed);
+    QVector<Transaction> transactions;
+    for (int id = 0; id < count; ++id) {
+        Transaction trans = randomTransaction(random, around);
+        trans.id = id;
+        transactions.append(trans);
+    }
+    return transactions;
+}
+
+LedgerVerifier::Report LedgerVerifier::run(quint32 seed, int ledgers, int maxRows) {
+    Report report;
+    std::mt19937 random(seed);
+    for (int n = 0; n < ledgers && report.failures.size() < MaxFailures; ++n) {
+        QDate around = QDate(2000, 1, 1).addDays(between(random, 0, 365 * 40));
+        QVector<Transaction> transactions = randomLedger(random(), between(random, 0, maxRows), around);
+
+        int before = int(report.failures.size());
+        if (n % 4 == 0) checkBinary(transactions, checkDates(random, around), report);
+        checkLedger(transactions, random, around, report);
+        if (report.failures.size() > before) {
+            report.fail(QString("  in ledger %1 of seed %2").arg(n).arg(seed));
+        }
+        ++report.ledgers;
+    }
+    return report;
+}
+
+void LedgerVerifier::checkSnapshot(const QByteArray &data, Report &report) {
+    QVector<Transaction> parsed;
+    int nextId = 0;
+    qint64 seq = 0;
+    if (!LedgerJournal::parseSnapshot(data, parsed, nextId, seq)) return;
+    ++report.ledgers;
+
+    // Rows the store would refuse (no id, or one already taken) are left out
+    QVector<Transaction> transactions;
+    QSet<int> ids;
+    for (const Transaction &trans : parsed) {
+        if (trans.id < 0 || ids.contains(trans.id)) continue;
+        ids.insert(trans.id);
+        transactions.append(trans);
+    }
+
+    Engine engine(transactions);
+    QVector<QDate> dates;
+    for (const Transaction &trans : transactions) {
+        if (dates.size() == BalanceKernels::MaxBatch) break;
+        if (trans.startDate.isValid()) dates.append(trans.startDate.addDays(dates.size() % 3 * 17));
+    }
+    if (dates.isEmpty()) return;
+
+    // The fast paths must at least agree with each other. Sums that could
+    // saturate depend on the order they are added up in, so only where none can.
+    qint64 lastDay = std::max_element(dates.begin(), dates.end())->toJulianDay() + 60;
+    qint64 span = qMax<qint64>(1, lastDay - engine.store.earliestStartDay() + 1);
+    qint64 limit = std::numeric_limits<qint64>::max() / 2 / span / qMax(1, engine.store.size());
+    bool exact = engine.store.largestAmount() < limit;
+    QVector<Money> balances, nets;
+    for (const QDate &date : dates) {
+        balances.append(engine.store.balanceUpTo(date));
+        nets.append(engine.store.netOn(date));
+    }
+    if (exact) compareBalances("fuzz", engine, dates, balances, nets, report);
+
+    BalanceTimeline timeline;
+    int first = int(std::min_element(dates.begin(), dates.end()) - dates.begin());
+    timeline.rebuild(engine.store, dates[first], dates[first].addDays(60));
+    if (exact && timeline.balanceOn(dates[first]) != balances[first]) {
+        report.fail("fuzz: timeline disagrees with the store");
+    }
+    ++report.checks;
+
+    // And the reference, where walking the days stays cheap
+    if (!exact || transactions.size() > MaxReferenceRows) return;
+    for (const Transaction &trans : transactions) {
+        for (const QDate &date : dates) {
+            if (trans.startDate.isValid() && qAbs(trans.startDate.daysTo(date)) > MaxReferenceDays) return;
+        }
+    }
+    for (int i = 0; i < dates.size(); ++i) {
+        if (referenceBalance(transactions, dates[i]) != balances[i]) {
+            report.fail(QString("fuzz %1: store balance differs from the reference").arg(dates[i].toString(Qt::ISODate)));
+        }
+        ++report.checks;
+    }
+}
@@ -0,0 +1,55 @@
+// ledgerverifier.h
+#ifndef LEDGERVERIFIER_H
+#define LEDGERVERIFIER_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QStringList>
+#include <QVector>
+
+#include "money.h"
+#include "transaction.h"
+
+// Differential checks of the engine, for moneycalendar-cli --verify and the
+// fuzz target (CONFIG += fuzz, see ledgerfuzz.cpp). A plain reference that
+// walks one transaction one day (monthly ones: one addMonths step) at a
+// time, straight from the definitions in transaction.h and sharing no code
+// with Recurrence, is compared against every fast path: the balance kernels
+// (whichever MONEYCALENDAR_KERNELS picks), the store's column loops, the
+// occurrence index, the balance timeline with its delta updates, and the JSON
+// and binary round trips. Ledgers are random but seeded, with deliberately
+// awkward schedules: unknown kinds, zero and negative intervals, month ends,
+// leap days, end dates and limits.
+namespace LedgerVerifier {
+
+struct Report {
+    int ledgers = 0;
+    qint64 checks = 0;
+    QStringList failures;          // the first MaxFailures, one line each
+
+    bool ok() const { return failures.isEmpty(); }
+    void fail(const QString &what);
+    QJsonObject toJson() const;
+};
+
+constexpr int MaxFailures = 50;
+
+// Same seed, same ledgers
+QVector<Transaction> randomLedger(quint32 seed, int count, const QDate &around);
+
+// Reference semantics, one day or month at a time; slow on purpose
+bool referenceOccursOn(const Transaction &trans, const QDate &date);
+int referenceCountUpTo(const Transaction &trans, const QDate &date);
+Money referenceBalance(const QVector<Transaction> &transactions, const QDate &date);
+
+// Every check on `ledgers` random ledgers of up to maxRows rows each
+Report run(quint32 seed, int ledgers, int maxRows = 60);
+
+// One fuzz input: parsed as a JSON snapshot, then whatever loads is pushed
+// through the engine and the fast paths are compared with each other (and
+// with the reference where that stays cheap)
+void checkSnapshot(const QByteArray &data, Report &report);
+
+} // namespace LedgerVerifier
+
+#endif // LEDGERVERIFIER_H
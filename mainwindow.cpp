@@ -1,102 +1,51 @@
 // mainwindow.cpp (updated)
 #include "mainwindow.h"
+#include "diagnosticsdialog.h"
+#include "instrumentation.h"
+#include "recurrence.h"
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QInputDialog>
+#include <QLocale>
 #include <QMessageBox>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QFile>
-#include <QDir>
+#include <QProgressDialog>
+#include <QSettings>
+#include <QShortcut>
 #include <QStandardPaths>
 
-// CustomCalendar implementation
-CustomCalendar::CustomCalendar(QWidget *parent) : QCalendarWidget(parent) {}
-
-void CustomCalendar::setTransactions(const QVector<Transaction> *trans) {
-    transactions = trans;
+static QString dataDirectory() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
 }
 
-void CustomCalendar::paintCell(QPainter *painter, const QRect &rect, QDate date) const {
-    // Draw default calendar cell (day number, background, etc.)
-    QCalendarWidget::paintCell(painter, rect, date);
-
-    if (!transactions) return;
-
-    // Existing: net transaction amount on this exact day → green/red overlay
-    double netOnDay = getNetAmountOnDate(date);
-    if (netOnDay != 0.0) {
-        painter->save();
-        painter->setPen(Qt::NoPen);
-        painter->setBrush(netOnDay > 0 ? QColor(0, 180, 0, 90) : QColor(220, 0, 0, 90));
-        painter->drawRect(rect.adjusted(2, 2, -2, -2));
-        painter->restore();
-    }
-
-    // NEW: Projected balance up to this date (including this day)
-    if (mainWindow) {
-        double projectedBalance = mainWindow->calculateBalance(date);
-
-        if (projectedBalance < 0.0) {
-            painter->save();
-
-            // Draw small red warning circle with ! in top-right corner
-            int size = qMin(rect.width(), rect.height()) / 4;  // e.g. 8–12 px
-            if (size < 10) size = 10;  // minimum readable size
-
-            QPoint center(rect.right() - size - 2, rect.top() + size + 2);
-
-            // Red circle
-            painter->setBrush(QColor(220, 30, 30));     // vivid red
-            painter->setPen(QColor(255, 255, 255, 180)); // light white border
-            painter->drawEllipse(center, size, size);
-
-            // White exclamation mark
-            painter->setPen(Qt::white);
-            painter->setFont(QFont("Arial", size * 1.4, QFont::Bold));
-            painter->drawText(QRect(center.x() - size, center.y() - size, size*2, size*2),
-                              Qt::AlignCenter, "!");
-
-            painter->restore();
-        }
-    }
+// Per-installation options, e.g. workspace/memoryBudgetMB
+static QSettings *settings() {
+    static QSettings file(dataDirectory() + "/settings.ini", QSettings::IniFormat);
+    return &file;
 }
 
-double CustomCalendar::getNetAmountOnDate(const QDate &date) const {
-    double net = 0.0;
-    if (!transactions || !mainWindow) return net;
-
-    for (const auto &trans : *transactions) {
-        if (mainWindow->isTransactionOnDate(trans, date)) {   // ← call MainWindow's version
-            net += trans.amount;
-        }
-    }
-    return net;
-}
-
-bool CustomCalendar::isTransactionOnDate(const Transaction &trans, const QDate &date) const {
-    if (date < trans.startDate) return false;
-
-    if (trans.recurrence == RecurrenceType::None) {
-        return trans.startDate == date;
-    } else if (trans.recurrence == RecurrenceType::BiWeekly) {
-        int daysDiff = trans.startDate.daysTo(date);
-        return daysDiff % 14 == 0;
-    } else if (trans.recurrence == RecurrenceType::Monthly) {
-        int startDay = trans.startDate.day();
-        int targetDay = (startDay > date.daysInMonth()) ? date.daysInMonth() : startDay;
-        return date.day() == targetDay;
-    }
-    return false;
+// One-time transactions from before this day go into the archive (see
+// Ledger::archive). Archived rows can't be deleted any more, so it is off
+// (archive/keepYears = 0) unless the settings turn it on
+static QDate archiveCutoff() {
+    int keepYears = settings()->value("archive/keepYears", 0).toInt();
+    if (keepYears <= 0) return QDate();
+    return QDate(QDate::currentDate().year() - keepYears, 1, 1);
 }
 
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
     calendar(new CustomCalendar),
-    eventList(new QListWidget),
+    eventList(new QListView),
     addButton(new QPushButton("Add Transaction")),
     deleteButton(new QPushButton("Delete Selected")),
+    importButton(new QPushButton("Import Statement...")),
+    ledgerCombo(new QComboBox),
+    newLedgerButton(new QPushButton("New Ledger...")),
     currentBalanceLabel(new QLabel("Current Balance (today): $0.00")),
-    selectedDateBalanceLabel(new QLabel("Balance on selected date: $0.00")) {
+    selectedDateBalanceLabel(new QLabel("Balance on selected date: $0.00")),
+    workspace(dataDirectory(),
+              settings()->value("workspace/memoryBudgetMB", Workspace::DefaultMemoryBudget >> 20).toLongLong() << 20) {
     calendar = new CustomCalendar(this);
     setWindowTitle("Financial Calendar Tracker");
     deleteButton->setEnabled(false);
@@ -104,12 +53,21 @@ MainWindow::MainWindow(QWidget *parent)
     QWidget *centralWidget = new QWidget(this);
     QVBoxLayout *mainLayout = new QVBoxLayout(centralWidget);
 
+    QHBoxLayout *ledgerLayout = new QHBoxLayout;
+    ledgerLayout->addWidget(new QLabel("Ledger:"));
+    ledgerLayout->addWidget(ledgerCombo, 1);
+    ledgerLayout->addWidget(newLedgerButton);
+    mainLayout->addLayout(ledgerLayout);
+
     mainLayout->addWidget(calendar);
+    eventList->setModel(&events);
+    eventList->setUniformItemSizes(true);   // no per-row size hints to compute
     mainLayout->addWidget(eventList);
 
     QHBoxLayout *buttonLayout = new QHBoxLayout;
     buttonLayout->addWidget(addButton);
     buttonLayout->addWidget(deleteButton);
+    buttonLayout->addWidget(importButton);
     mainLayout->addLayout(buttonLayout);
 
     mainLayout->addWidget(currentBalanceLabel);
@@ -120,22 +78,45 @@ MainWindow::MainWindow(QWidget *parent)
     connect(calendar, &QCalendarWidget::clicked, this, &MainWindow::onDateSelected);
     connect(addButton, &QPushButton::clicked, this, &MainWindow::onAddButtonClicked);
     connect(deleteButton, &QPushButton::clicked, this, &MainWindow::onDeleteButtonClicked);
-    connect(eventList, &QListWidget::itemSelectionChanged, this, &MainWindow::onEventSelectionChanged);
+    connect(importButton, &QPushButton::clicked, this, &MainWindow::onImportButtonClicked);
+    connect(newLedgerButton, &QPushButton::clicked, this, &MainWindow::onNewLedgerClicked);
+    connect(eventList->selectionModel(), &QItemSelectionModel::selectionChanged, this, &MainWindow::onEventSelectionChanged);
+    connect(calendar, &QCalendarWidget::currentPageChanged, this, &MainWindow::onCalendarPageChanged);
+
+    connect(&projections, &ProjectionService::projectionReady, this, &MainWindow::onProjectionReady);
 
-    loadTransactions();
-    calendar->setTransactions(&transactions);
-    calendar->setBalanceCalculator(this);
+    calendar->setProjections(&projections);
+
+    // A fresh install starts with one ledger
+    if (workspace.names().isEmpty()) {
+        workspace.create(Workspace::FirstLedgerName);
+    }
+    for (const QString &name : workspace.names()) {
+        ledgerCombo->addItem(name, name);
+    }
+    ledgerCombo->addItem("All ledgers", QString());
+    int last = ledgerCombo->findData(settings()->value("workspace/ledger").toString());
+    ledgerCombo->setCurrentIndex(qMax(last, 0));
+    selectedDate = QDate::currentDate();
+    showLedger(ledgerCombo->currentData().toString());
+    connect(ledgerCombo, &QComboBox::currentIndexChanged, this, &MainWindow::onLedgerChanged);
 
     onDateSelected(QDate::currentDate());
     updateBalances();
+
+#ifdef MONEYCALENDAR_INSTRUMENTATION
+    QShortcut *diagnostics = new QShortcut(QKeySequence("Ctrl+Shift+D"), this);
+    connect(diagnostics, &QShortcut::activated, this, &MainWindow::onDiagnosticsRequested);
+#endif
 }
 
 
 MainWindow::~MainWindow() {
-    saveTransactions();
+    workspace.saveAll();
 }
 
 void MainWindow::onDateSelected(const QDate &date) {
+    MC_TRACE_SCOPE("MainWindow::onDateSelected");
     selectedDate = date;
     updateEventList(date);
     updateBalances();          // ← important: refresh both labels
@@ -143,6 +124,7 @@ void MainWindow::onDateSelected(const QDate &date) {
 }
 
 void MainWindow::onAddButtonClicked() {
+    if (!ledger) return;
     AddTransactionDialog dialog(selectedDate, this);
     if (dialog.exec() == QDialog::Accepted) {
         Transaction trans;
@@ -155,21 +137,19 @@ void MainWindow::onAddButtonClicked() {
             trans.intervalMonths = dialog.getIntervalMonths();
         } else if (trans.recurrence == RecurrenceType::Monthly) {
             trans.intervalMonths = 1;
+        } else if (trans.recurrence == RecurrenceType::EveryNDays) {
+            trans.intervalDays = dialog.getIntervalDays();
+        } else if (trans.recurrence == RecurrenceType::NthWeekday) {
+            trans.weekOfMonth = dialog.getWeekOfMonth();
         } // else ignored
+        trans.endDate = dialog.getEndDate();
+        trans.occurrenceLimit = dialog.getOccurrenceLimit();
 
-        trans.id = nextTransactionId++;
-        transactions.append(trans);
-        // ... save, update, etc.
-
-    // if (dialog.exec() == QDialog::Accepted) {
-    //     Transaction trans;
-    //     trans.startDate = selectedDate;
-    //     trans.description = dialog.getDescription().trimmed();
-    //     trans.amount = dialog.getAmount();
-    //     trans.recurrence = dialog.getRecurrence();
-    //     trans.id = nextTransactionId++;
-    //     transactions.append(trans);
-        saveTransactions();
+        MC_TRACE_SCOPE("MainWindow::addTransaction");
+        ledger->add(trans);   // assigns the id and journals it
+        if (!projections.applyEdit({ trans }, 1, ledger->snapshot())) {
+            refreshTimeline(true);
+        }
         updateEventList(selectedDate);
         updateBalances();
         calendar->update();
@@ -177,7 +157,7 @@ void MainWindow::onAddButtonClicked() {
 }
 
 void MainWindow::onDeleteButtonClicked() {
-    QList<QListWidgetItem*> selected = eventList->selectedItems();
+    QModelIndexList selected = eventList->selectionModel()->selectedRows();
     if (selected.isEmpty()) return;
 
     QMessageBox::StandardButton reply = QMessageBox::question(
@@ -186,232 +166,236 @@ void MainWindow::onDeleteButtonClicked() {
 
     if (reply != QMessageBox::Yes) return;
 
-    QSet<int> idsToDelete;
-    for (QListWidgetItem *item : selected) {
-        QString text = item->text();
-        for (const auto &t : transactions) {
-            QString expected = t.description + " (" + QString::number(t.amount, 'f', 2) + ")";
-            if (t.recurrence != RecurrenceType::None) {
-                expected += " [" + recurrenceToString(t) + "]";       // ← change to recurrenceToString(t)
-            }
-            if (text == expected) {
-                idsToDelete.insert(t.id);
-                break;
-            }
-        }
+    // Per ledger, as the consolidated view lists several
+    QMap<int, QVector<int>> idsToDelete;
+    QMap<int, QVector<Transaction>> deleted;
+    for (const QModelIndex &index : selected) {
+        int owner = events.ledgerAt(index.row());
+        int id = events.transactionIdAt(index.row());
+        idsToDelete[owner].append(id);
+        deleted[owner].append(shownLedgers[owner]->transaction(id));
     }
 
-    for (int i = transactions.size() - 1; i >= 0; --i) {
-        if (idsToDelete.contains(transactions[i].id)) {
-            transactions.removeAt(i);
-        }
+    MC_TRACE_SCOPE("MainWindow::deleteTransactions");
+    bool anyRemoved = false;
+    bool applied = true;
+    int archivedKept = 0;
+    for (auto it = idsToDelete.constBegin(); it != idsToDelete.constEnd(); ++it) {
+        Ledger &owner = *shownLedgers[it.key()];
+        int removed = owner.remove(it.value());
+        if (!owner.isReadOnly()) archivedKept += int(it.value().size()) - removed;
+        if (removed == 0) continue;
+        anyRemoved = true;
+        applied = applied && removed == deleted[it.key()].size()
+                  && projections.applyEdit(deleted[it.key()], -1, owner.snapshot());
+    }
+    if (archivedKept > 0) {
+        QMessageBox::information(this, "Archived Transactions",
+            QString("%1 of the selected transactions are archived and were not deleted. "
+                    "Archived transactions are kept for good; set archive/keepYears in "
+                    "settings.ini to 0 to stop archiving new ones.").arg(archivedKept));
+    }
+    if (!anyRemoved) return;
+    if (!applied) {
+        refreshTimeline(true);
     }
-
-    saveTransactions();
     updateEventList(selectedDate);
     updateBalances();
     calendar->update();
 }
 
-void MainWindow::onEventSelectionChanged() {
-    deleteButton->setEnabled(!eventList->selectedItems().isEmpty());
-}
+void MainWindow::onImportButtonClicked() {
+    if (!ledger) return;
+    QString file = QFileDialog::getOpenFileName(this, "Import Bank Statement", QString(),
+                                                "Bank statements (*.csv *.ofx *.qfx *.qif);;All files (*)");
+    if (file.isEmpty()) return;
 
-void MainWindow::updateEventList(const QDate &date) {
-    eventList->clear();
-    for (const auto &trans : transactions) {
-        if (isTransactionOnDate(trans, date)) {
-            QString itemText = trans.description + " (" + QString::number(trans.amount, 'f', 2) + ")";
-            if (trans.recurrence != RecurrenceType::None) {
-                itemText += " [" + recurrenceToString(trans) + "]";   // ← pass trans, not trans.recurrence
-            }
-            eventList->addItem(itemText);
-        }
-    }
-}
+    QProgressDialog progress("Importing " + QFileInfo(file).fileName() + "...", "Cancel", 0, 1000, this);
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setMinimumDuration(500);
 
+    Ledger::ImportResult result = ledger->import(file, [&](qint64 done, qint64 total) {
+        progress.setValue(total > 0 ? int(done * 1000 / total) : 0);
+        return !progress.wasCanceled();
+    });
+    progress.reset();
+    if (result.cancelled) return;
 
-void MainWindow::updateBalances() {
-    QDate today = QDate::currentDate();
-    double current = calculateBalance(today);
-    currentBalanceLabel->setText("Current Balance (today): $" + QString::number(current, 'f', 2));
+    if (result.added > 0) {
+        refreshTimeline(true);
+        updateEventList(selectedDate);
+        updateBalances();
+        calendar->update();
+    }
 
-    double selectedBalance = calculateBalance(selectedDate);
-    QString dateStr = selectedDate.toString("yyyy-MM-dd");
-    if (selectedDate == today) {
-        selectedDateBalanceLabel->setText("Balance on selected date (today): $" + QString::number(selectedBalance, 'f', 2));
-    } else if (selectedDate < today) {
-        selectedDateBalanceLabel->setText("Historical Balance on " + dateStr + ": $" + QString::number(selectedBalance, 'f', 2));
+    QString summary = QString("Imported %1 transaction(s).").arg(result.added);
+    if (result.duplicates > 0) summary += QString("\nSkipped %1 already in the calendar.").arg(result.duplicates);
+    if (result.rejected > 0) summary += QString("\nSkipped %1 unreadable row(s).").arg(result.rejected);
+    if (!result.ok) {
+        QMessageBox::warning(this, "Import", summary + "\nThe statement or the calendar file could not be read or saved.");
     } else {
-        selectedDateBalanceLabel->setText("Projected Balance on " + dateStr + ": $" + QString::number(selectedBalance, 'f', 2));
+        QMessageBox::information(this, "Import", summary);
     }
 }
 
-double MainWindow::calculateBalance(const QDate &upToDate) const {
-    double balance = 0.0;
+void MainWindow::onLedgerChanged(int index) {
+    QString name = ledgerCombo->itemData(index).toString();
+    settings()->setValue("workspace/ledger", name);
+    showLedger(name);
+}
 
-    for (const auto &trans : transactions) {
-        if (trans.recurrence == RecurrenceType::None) {
-            if (trans.startDate <= upToDate) {
-                balance += trans.amount;
-            }
-        }
-        else if (trans.recurrence == RecurrenceType::Weekly) {
-            QDate current = trans.startDate;
-            while (current <= upToDate) {
-                balance += trans.amount;
-                current = current.addDays(7);
-            }
-        }
-        else if (trans.recurrence == RecurrenceType::BiWeekly) {
-            QDate current = trans.startDate;
-            while (current <= upToDate) {
-                balance += trans.amount;
-                current = current.addDays(14);
-            }
-        }
-        else {  // Monthly or EveryNMonths
-            int interval = (trans.recurrence == RecurrenceType::Monthly) ? 1 : trans.intervalMonths;
-            QDate current = trans.startDate;
-            while (current <= upToDate) {
-                balance += trans.amount;
-                current = current.addMonths(interval);
-            }
-        }
+void MainWindow::onNewLedgerClicked() {
+    QString name = QInputDialog::getText(this, "New Ledger", "Name:").trimmed();
+    if (name.isEmpty()) return;
+
+    if (!workspace.create(name)) {
+        QMessageBox::warning(this, "New Ledger", "There already is a ledger called \"" + name
+                             + "\", or the name can't be used as a folder name.");
+        return;
     }
-    return balance;
+    ledgerCombo->insertItem(int(workspace.names().indexOf(name)), name, name);
+    ledgerCombo->setCurrentIndex(ledgerCombo->findData(name));
 }
 
-bool MainWindow::isTransactionOnDate(const Transaction &trans, const QDate &date) const {
-    if (date < trans.startDate) return false;
+void MainWindow::showLedger(const QString &name) {
+    MC_TRACE_SCOPE("MainWindow::showLedger");
 
-    switch (trans.recurrence) {
-    case RecurrenceType::None:
-        return trans.startDate == date;
+    // Let go of the old ones first, so the workspace may drop them
+    events.setLedgers({});
+    shownLedgers.clear();
+    ledger.reset();
 
-    case RecurrenceType::Weekly:
-    {
-        int daysDiff = trans.startDate.daysTo(date);
-        return (daysDiff >= 0) && (daysDiff % 7 == 0);
+    if (name.isEmpty()) {
+        for (const QString &each : workspace.names()) {
+            if (auto loaded = workspace.ledger(each)) shownLedgers.append(loaded);
+        }
+    } else {
+        ledger = workspace.ledger(name);
+        if (ledger) shownLedgers.append(ledger);
+    }
+    for (const auto &shown : shownLedgers) {
+        shown->archive(archiveCutoff());   // cheap when there is nothing new to archive
     }
 
-    case RecurrenceType::BiWeekly:
-    {
-        int daysDiff = trans.startDate.daysTo(date);
-        return (daysDiff >= 0) && (daysDiff % 14 == 0);
+    QVector<const Ledger *> listed;
+    for (const auto &shown : shownLedgers) {
+        listed.append(shown.get());
     }
+    events.setLedgers(listed);
 
-    case RecurrenceType::Monthly:
-    case RecurrenceType::EveryNMonths:
-    {
-        int monthsDiff = (date.year() - trans.startDate.year()) * 12
-                         + (date.month() - trans.startDate.month());
-        if (monthsDiff < 0) return false;
+    // Adding and importing need one ledger to go to
+    addButton->setEnabled(ledger != nullptr);
+    importButton->setEnabled(ledger != nullptr);
 
-        int interval = (trans.recurrence == RecurrenceType::Monthly)
-                           ? 1 : trans.intervalMonths;
+    refreshTimeline(true);
+    updateEventList(selectedDate);
+    updateBalances();
+    calendar->update();
+}
 
-        if (monthsDiff % interval != 0) return false;
+void MainWindow::onEventSelectionChanged() {
+    deleteButton->setEnabled(eventList->selectionModel()->hasSelection());
+}
 
-        int targetDay = trans.startDate.day();
-        int actualDay = (targetDay > date.daysInMonth()) ? date.daysInMonth() : targetDay;
-        return date.day() == actualDay;
-    }
-    }
+void MainWindow::onCalendarPageChanged(int year, int month) {
+    MC_TRACE_SCOPE("MainWindow::onCalendarPageChanged");
 
-    return false;
-}
+    // Only single steps count as paging; a jump (e.g. to a picked date) doesn't
+    QDate page(year, month, 1);
+    int months = lastPage.isValid() ? (page.year() - lastPage.year()) * 12 + page.month() - lastPage.month() : 0;
+    pageDirection = (months == 1 || months == -1) ? months : 0;
+    lastPage = page;
 
-QString MainWindow::recurrenceToString(const Transaction &trans) const {
-    switch (trans.recurrence) {
-    case RecurrenceType::None:        return "";
-    case RecurrenceType::Weekly:      return "Weekly";
-    case RecurrenceType::BiWeekly:    return "Bi-weekly";
-    case RecurrenceType::Monthly:     return "Monthly";
-    case RecurrenceType::EveryNMonths:
-        return QString("Every %1 months").arg(trans.intervalMonths);
-    }
-    return "";
+    refreshTimeline();
+    calendar->update();
 }
 
-void MainWindow::saveTransactions() const {
-    QJsonArray jsonArray;
-    for (const auto &trans : transactions) {
-        QJsonObject obj;
-        obj["startDate"]     = trans.startDate.toString(Qt::ISODate);
-        obj["description"]   = trans.description;
-        obj["amount"]        = trans.amount;
-        obj["recurrence"]    = static_cast<int>(trans.recurrence);
-        obj["intervalMonths"] = trans.intervalMonths;     // important for the new every-N-months feature
-        obj["id"]            = trans.id;
-        jsonArray.append(obj);
-    }
-
-    QJsonObject root;
-    root["transactions"] = jsonArray;
-    root["nextId"]       = nextTransactionId;
+void MainWindow::onProjectionReady() {
+    MC_TRACE_SCOPE("MainWindow::onProjectionReady");
+    updateBalances();
+    calendar->update();
+}
 
-    QJsonDocument doc(root);
+void MainWindow::updateEventList(const QDate &date) {
+    MC_TRACE_SCOPE("MainWindow::updateEventList");
+    events.setDate(date);
+    onEventSelectionChanged();   // a reset clears the selection without signalling it
+}
 
-    QString filePath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
-                       + "/transactions.json";
+void MainWindow::updateBalances() {
+    MC_TRACE_SCOPE("MainWindow::updateBalances");
+    refreshTimeline();
 
-    QDir dir;
-    dir.mkpath(QFileInfo(filePath).absolutePath());   // make sure folder exists
+    QDate today = QDate::currentDate();
+    currentBalanceLabel->setText("Current Balance (today): " + balanceText(today));
 
-    QFile file(filePath);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        file.write(doc.toJson(QJsonDocument::Indented));
-        file.close();
+    QString selectedBalance = balanceText(selectedDate);
+    QString dateStr = selectedDate.toString("yyyy-MM-dd");
+    if (selectedDate == today) {
+        selectedDateBalanceLabel->setText("Balance on selected date (today): " + selectedBalance);
+    } else if (selectedDate < today) {
+        selectedDateBalanceLabel->setText("Historical Balance on " + dateStr + ": " + selectedBalance);
     } else {
-        qWarning() << "Could not save transactions:" << file.errorString();
+        selectedDateBalanceLabel->setText("Projected Balance on " + dateStr + ": " + selectedBalance);
     }
 }
 
-void MainWindow::loadTransactions() {
-    QString filePath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)
-    + "/transactions.json";
-
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return;  // first run → no file yet, that's fine
+QString MainWindow::balanceText(const QDate &date) const {
+    const ProjectionService::Projection &projection = projections.latest();
+    if (projection.timeline.covers(date)) {
+        return "$" + projection.timeline.balanceOn(date).toString();
     }
-
-    QByteArray data = file.readAll();
-    file.close();
-
-    QJsonDocument doc = QJsonDocument::fromJson(data);
-    if (doc.isNull() || !doc.isObject()) {
-        qWarning() << "Invalid JSON in transactions file";
-        return;
+    auto found = projection.balances.constFind(date);
+    if (found != projection.balances.constEnd()) {
+        return "$" + found.value().toString();
     }
+    return "…";
+}
 
-    QJsonObject root = doc.object();
+void MainWindow::refreshTimeline(bool ledgerChanged) {
+    QDate shown(calendar->yearShown(), calendar->monthShown(), 1);
+    QVector<QDate> labelDates = { QDate::currentDate(), selectedDate };
 
-    nextTransactionId = root["nextId"].toInt(0);
+    // While paging, most of the range lies ahead, so a held arrow key finds
+    // the next pages projected already
+    int ahead = TimelineMonthsAround + pageDirection * (TimelineMonthsAround - 1);
+    QDate from = shown.addMonths(ahead - 2 * TimelineMonthsAround);
+    QDate to = shown.addMonths(ahead + 1).addDays(-1);
 
-    QJsonArray jsonArray = root["transactions"].toArray();
-    for (const auto &val : jsonArray) {
-        if (!val.isObject()) continue;
+    // Browsing into archived years loads their rows, leaving them drops them again
+    bool archiveChanged = false;
+    for (const auto &each : shownLedgers) {
+        archiveChanged = each->showArchive(from, to) || archiveChanged;
+    }
+    if (archiveChanged) {
+        events.setDate(selectedDate);
+        onEventSelectionChanged();
+    }
 
-        QJsonObject obj = val.toObject();
-        Transaction trans;
-        trans.startDate     = QDate::fromString(obj["startDate"].toString(), Qt::ISODate);
-        trans.description   = obj["description"].toString();
-        trans.amount        = obj["amount"].toDouble();
-        trans.recurrence    = static_cast<RecurrenceType>(obj["recurrence"].toInt());
-        trans.intervalMonths = obj["intervalMonths"].toInt(1);   // default 1 if missing
-        trans.id            = obj["id"].toInt(-1);
-
-        // Safety: assign new ID if corrupted/missing
-        if (trans.id < 0) {
-            trans.id = nextTransactionId++;
-        } else {
-            nextTransactionId = qMax(nextTransactionId, trans.id + 1);
-        }
+    // A page shows 6 weeks starting up to 7 days before the 1st. Ask again
+    // as soon as the next page in the paging direction isn't covered, so it
+    // is projected while this one is looked at.
+    QDate next = shown.addMonths(pageDirection);
+    if (!ledgerChanged && !archiveChanged
+        && projections.isRequested(qMin(shown, next).addDays(-7), qMax(shown, next).addDays(35), labelDates)) {
+        return;
+    }
+
+    QVector<LedgerSnapshot> snapshots;
+    for (const auto &shown : shownLedgers) {
+        snapshots.append(shown->snapshot());
+    }
+    // A page seen a moment ago paints at once while the range around it is projected
+    projections.useRecent(snapshots, shown.addDays(-7), shown.addDays(35), labelDates);
+    projections.request(snapshots, from, to, labelDates);
+}
 
-        transactions.append(trans);
+void MainWindow::onDiagnosticsRequested() {
+    if (!diagnostics) {
+        diagnostics = new DiagnosticsDialog(this);
     }
+    diagnostics->show();
+    diagnostics->raise();
 }
 
 // AddTransactionDialog implementation
@@ -420,7 +404,11 @@ AddTransactionDialog::AddTransactionDialog(const QDate &date, QWidget *parent)
     descEdit(new QLineEdit),
     amountSpin(new QDoubleSpinBox),
     recurrenceCombo(new QComboBox),
-    intervalSpin(new QSpinBox){
+    intervalSpin(new QSpinBox),
+    endCheck(new QCheckBox("Until")),
+    endEdit(new QDateEdit(date.addYears(1))),
+    limitSpin(new QSpinBox),
+    weekOfMonth(date.day() > 28 ? -1 : (date.day() - 1) / 7 + 1) {
 
     setWindowTitle("Add Transaction - " + date.toString("yyyy-MM-dd"));
 
@@ -435,6 +423,14 @@ AddTransactionDialog::AddTransactionDialog(const QDate &date, QWidget *parent)
     recurrenceCombo->addItem("Every 2 months", static_cast<int>(RecurrenceType::EveryNMonths));
     recurrenceCombo->addItem("Every 3 months", static_cast<int>(RecurrenceType::EveryNMonths));
     recurrenceCombo->addItem("Every 4 months", static_cast<int>(RecurrenceType::EveryNMonths));
+    recurrenceCombo->addItem("Every N days", static_cast<int>(RecurrenceType::EveryNDays));
+    recurrenceCombo->setItemData(recurrenceCombo->count() - 1, 1, DaysPerUnitRole);
+    recurrenceCombo->addItem("Every N weeks", static_cast<int>(RecurrenceType::EveryNDays));
+    recurrenceCombo->setItemData(recurrenceCombo->count() - 1, 7, DaysPerUnitRole);
+    QString weekday = QLocale().dayName(date.dayOfWeek());
+    QString week = (weekOfMonth < 0) ? "last" : QStringList{ "1st", "2nd", "3rd", "4th" }.at(weekOfMonth - 1);
+    recurrenceCombo->addItem("Monthly on the " + week + " " + weekday, static_cast<int>(RecurrenceType::NthWeekday));
+    recurrenceCombo->addItem("Last business day of each month", static_cast<int>(RecurrenceType::LastBusinessDay));
 
     intervalSpin->setRange(2, 12);
     intervalSpin->setValue(2);
@@ -444,16 +440,46 @@ AddTransactionDialog::AddTransactionDialog(const QDate &date, QWidget *parent)
     // Show/hide interval spinbox based on selection
     connect(recurrenceCombo, &QComboBox::currentIndexChanged, this, [this](int index) {
         RecurrenceType type = static_cast<RecurrenceType>(recurrenceCombo->itemData(index).toInt());
-        bool showInterval = (type == RecurrenceType::EveryNMonths);
+        bool showInterval = (type == RecurrenceType::EveryNMonths || type == RecurrenceType::EveryNDays);
+        if (type == RecurrenceType::EveryNDays) {
+            bool weeks = recurrenceCombo->itemData(index, DaysPerUnitRole).toInt() == 7;
+            intervalSpin->setRange(1, weeks ? 52 : 365);
+            intervalSpin->setSuffix(weeks ? " weeks" : " days");
+        } else {
+            intervalSpin->setRange(2, 12);
+            intervalSpin->setSuffix(" months");
+        }
         intervalSpin->setEnabled(showInterval);
         intervalSpin->setVisible(showInterval);
+
+        bool repeats = (type != RecurrenceType::None);
+        endCheck->setEnabled(repeats);
+        limitSpin->setEnabled(repeats);
     });
 
+    // Optional end: a last date and/or a number of occurrences
+    endEdit->setCalendarPopup(true);
+    endEdit->setMinimumDate(date);
+    endEdit->setEnabled(false);
+    connect(endCheck, &QCheckBox::toggled, endEdit, &QWidget::setEnabled);
+    endCheck->setEnabled(false);
+
+    limitSpin->setRange(0, 9999);
+    limitSpin->setSpecialValueText("No limit");
+    limitSpin->setSuffix(" times");
+    limitSpin->setEnabled(false);
+
+    QHBoxLayout *endRow = new QHBoxLayout;
+    endRow->addWidget(endCheck);
+    endRow->addWidget(endEdit);
+
     QFormLayout *form = new QFormLayout;
     form->addRow("Description:", descEdit);
     form->addRow("Amount:", amountSpin);
     form->addRow("Recurrence:", recurrenceCombo);
     form->addRow("Interval:", intervalSpin);  // will be shown conditionally
+    form->addRow("Ends:", endRow);
+    form->addRow("Repeat:", limitSpin);
 
     QDialogButtonBox *buttons = new QDialogButtonBox(
         QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
@@ -470,8 +496,8 @@ QString AddTransactionDialog::getDescription() const {
     return descEdit->text();
 }
 
-double AddTransactionDialog::getAmount() const {
-    return amountSpin->value();
+Money AddTransactionDialog::getAmount() const {
+    return Money::fromDouble(amountSpin->value());
 }
 
 RecurrenceType AddTransactionDialog::getRecurrence() const {
@@ -483,6 +509,20 @@ int AddTransactionDialog::getIntervalMonths() const {
     return intervalSpin->value();
 }
 
-void CustomCalendar::setBalanceCalculator(MainWindow *mw) {
-    mainWindow = mw;
+int AddTransactionDialog::getIntervalDays() const {
+    return intervalSpin->value() * recurrenceCombo->currentData(DaysPerUnitRole).toInt();
 }
+
+int AddTransactionDialog::getWeekOfMonth() const {
+    return weekOfMonth;
+}
+
+QDate AddTransactionDialog::getEndDate() const {
+    bool ends = endCheck->isEnabled() && endCheck->isChecked();
+    return ends ? endEdit->date() : QDate();
+}
+
+int AddTransactionDialog::getOccurrenceLimit() const {
+    return limitSpin->isEnabled() ? limitSpin->value() : 0;
+}
+
@@ -4,7 +4,7 @@
 
 #include <QMainWindow>
 #include <QCalendarWidget>
-#include <QListWidget>
+#include <QListView>
 #include <QPushButton>
 #include <QLabel>
 #include <QVector>
@@ -19,79 +19,67 @@
 #include <QFormLayout>
 #include <QDialogButtonBox>
 #include <QPainter>
+#include <QPixmap>
 #include <QTextCharFormat>
 #include <QSpinBox>
+#include <QCheckBox>
+#include <QDateEdit>
 
-enum class RecurrenceType {
-    None,
-    Weekly,
-    BiWeekly,
-    Monthly,       // = every 1 month
-    EveryNMonths   // 2,3,4,... months
-};
-
-struct Transaction {
-    QDate startDate;
-    QString description;
-    double amount;
-    RecurrenceType recurrence = RecurrenceType::None;
-    int intervalMonths = 1;   // only used when recurrence == EveryNMonths
-    int id = -1;
-};
-
-class MainWindow;
-
-class CustomCalendar : public QCalendarWidget {
-    Q_OBJECT
-
-public:
-    CustomCalendar(QWidget *parent = nullptr);
-    void setTransactions(const QVector<Transaction> *trans);
-    void setBalanceCalculator(MainWindow *mw);
-
-protected:
-    // Changed: remove & from the third parameter
-    void paintCell(QPainter *painter, const QRect &rect, QDate date) const override;
+#include "customcalendar.h"
+#include "eventlistmodel.h"
+#include "ledger.h"
+#include "projectionservice.h"
+#include "workspace.h"
 
-private:
-    const QVector<Transaction> *transactions = nullptr;
-    MainWindow *mainWindow = nullptr;           // NEW
-    double getNetAmountOnDate(const QDate &date) const;
-    bool isTransactionOnDate(const Transaction &trans, const QDate &date) const;
-};
+class DiagnosticsDialog;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
-    friend class CustomCalendar;
 public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
-    bool isTransactionOnDate(const Transaction &trans, const QDate &date) const;
 
 private slots:
     void onDateSelected(const QDate &date);
     void onAddButtonClicked();
     void onDeleteButtonClicked();
+    void onImportButtonClicked();
+    void onLedgerChanged(int index);
+    void onNewLedgerClicked();
     void onEventSelectionChanged();
+    void onCalendarPageChanged(int year, int month);
+    void onProjectionReady();
+    void onDiagnosticsRequested();
 
 private:
     CustomCalendar *calendar;
-    QListWidget *eventList;
+    QListView *eventList;
     QPushButton *addButton;
     QPushButton *deleteButton;
+    QPushButton *importButton;
+    QComboBox *ledgerCombo;         // each ledger, then "All ledgers"
+    QPushButton *newLedgerButton;
     QLabel *currentBalanceLabel;
     QLabel *selectedDateBalanceLabel;   // ← changed name for clarity
-    QVector<Transaction> transactions;
+    Workspace workspace;
+    std::shared_ptr<Ledger> ledger;                  // where new transactions go; null in the consolidated view
+    QVector<std::shared_ptr<Ledger>> shownLedgers;   // what the calendar and eventList show
+    EventListModel events;   // the selected day's transactions, shown by eventList
     QDate selectedDate;
-    int nextTransactionId = 0;
-    QString recurrenceToString(const Transaction &trans) const;
+    DiagnosticsDialog *diagnostics = nullptr;   // created on first Ctrl+Shift+D
 
+    // Daily balances this many months around the visible page, projected on
+    // a worker thread whenever the ledger changes or the page leaves that range
+    ProjectionService projections;
+    static constexpr int TimelineMonthsAround = 2;
+    QDate lastPage;                 // 1st of the month shown before
+    int pageDirection = 0;          // 1 / -1 while paging forward / back, else 0
+
+    void showLedger(const QString &name);   // "" for every ledger at once
     void updateEventList(const QDate &date);
     void updateBalances();
-    void saveTransactions() const;
-    void loadTransactions();
-
-    double calculateBalance(const QDate &upToDate) const;
+    void refreshTimeline(bool ledgerChanged = false);
+    QString balanceText(const QDate &date) const;   // "$12.34", or a placeholder while pending
 };
 
 class AddTransactionDialog : public QDialog {
@@ -100,15 +88,25 @@ class AddTransactionDialog : public QDialog {
 public:
     AddTransactionDialog(const QDate &date, QWidget *parent = nullptr);
     QString getDescription() const;
-    double getAmount() const;
+    Money getAmount() const;
     RecurrenceType getRecurrence() const;
     int getIntervalMonths() const;     // ← MUST be here
+    int getIntervalDays() const;
+    int getWeekOfMonth() const;
+    QDate getEndDate() const;          // invalid if it doesn't end
+    int getOccurrenceLimit() const;    // 0 if unlimited
 
 private:
+    static constexpr int DaysPerUnitRole = Qt::UserRole + 1;   // 1 or 7 for Every N days / weeks
+
     QLineEdit *descEdit;
     QDoubleSpinBox *amountSpin;
     QComboBox *recurrenceCombo;
     QSpinBox *intervalSpin;  // NEW - shown only for Every N Months
+    QCheckBox *endCheck;
+    QDateEdit *endEdit;
+    QSpinBox *limitSpin;
+    int weekOfMonth;         // of the start date: 1-4, or -1 after the 28th
 };
 
 #endif // MAINWINDOW_H
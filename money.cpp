@@ -0,0 +1,47 @@
+// money.cpp
+#include "money.h"
+
+#include <QDebug>
+#include <QtNumeric>
+
+#include <cmath>
+#include <limits>
+
+Money Money::fromDouble(double amount) {
+    double cents = std::round(amount * 100.0);
+    if (!std::isfinite(cents)) return Money();
+    if (cents >= 9.2e18 || cents <= -9.2e18) return saturated(cents < 0);
+    return Money(qint64(cents));
+}
+
+QString Money::toString() const {
+    // Magnitude as unsigned, so the most negative value doesn't overflow
+    quint64 magnitude = value < 0 ? 0 - quint64(value) : quint64(value);
+    return QString("%1%2.%3")
+        .arg(value < 0 ? "-" : "")
+        .arg(magnitude / 100)
+        .arg(magnitude % 100, 2, 10, QChar('0'));
+}
+
+Money Money::saturated(bool negative) {
+    qWarning() << "Money overflow: result saturated";
+    return Money(negative ? std::numeric_limits<qint64>::min() : std::numeric_limits<qint64>::max());
+}
+
+Money Money::operator+(Money other) const {
+    qint64 result;
+    if (qAddOverflow(value, other.value, &result)) return saturated(other.value < 0);
+    return Money(result);
+}
+
+Money Money::operator-(Money other) const {
+    qint64 result;
+    if (qSubOverflow(value, other.value, &result)) return saturated(other.value > 0);
+    return Money(result);
+}
+
+Money Money::operator*(qint64 factor) const {
+    qint64 result;
+    if (qMulOverflow(value, factor, &result)) return saturated((value < 0) != (factor < 0));
+    return Money(result);
+}
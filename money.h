@@ -0,0 +1,49 @@
+// money.h
+#ifndef MONEY_H
+#define MONEY_H
+
+#include <QString>
+#include <QtGlobal>
+
+// An amount of money as a whole number of cents, so sums of any length are
+// exact and "does this cancel out to zero" is a plain integer test.
+// Arithmetic that would overflow 64 bits saturates (with a warning) instead
+// of wrapping around.
+class Money {
+public:
+    constexpr Money() = default;
+
+    static constexpr Money fromCents(qint64 cents) { return Money(cents); }
+    static Money fromDouble(double amount);   // rounded to the nearest cent
+
+    constexpr qint64 cents() const { return value; }
+    double toDouble() const { return value / 100.0; }
+    QString toString() const;                 // "1234.56", "-0.05"
+
+    constexpr bool isZero() const { return value == 0; }
+    constexpr bool isNegative() const { return value < 0; }
+    constexpr bool isPositive() const { return value > 0; }
+
+    Money operator+(Money other) const;
+    Money operator-(Money other) const;
+    Money operator*(qint64 factor) const;
+    Money operator-() const { return Money() - *this; }
+    Money &operator+=(Money other) { return *this = *this + other; }
+    Money &operator-=(Money other) { return *this = *this - other; }
+
+    constexpr bool operator==(Money other) const { return value == other.value; }
+    constexpr bool operator!=(Money other) const { return value != other.value; }
+    constexpr bool operator<(Money other) const { return value < other.value; }
+    constexpr bool operator>(Money other) const { return value > other.value; }
+    constexpr bool operator<=(Money other) const { return value <= other.value; }
+    constexpr bool operator>=(Money other) const { return value >= other.value; }
+
+private:
+    constexpr explicit Money(qint64 cents) : value(cents) {}
+
+    static Money saturated(bool negative);
+
+    qint64 value = 0;
+};
+
+#endif // MONEY_H
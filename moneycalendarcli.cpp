@@ -0,0 +1,223 @@
+// moneycalendarcli.cpp
+// Daily projected balances of one or more ledgers as CSV, without the GUI:
+//
+//   moneycalendar-cli [--from DATE] [--to DATE] [--stream] [--output-dir DIR] LEDGER...
+//
+// LEDGER is a ledger folder (snapshot + journal, as written by the app) or a
+// single .json / .mcl snapshot. Ledgers are only read, never modified.
+//
+//   moneycalendar-cli --benchmark [--sizes N,...] [--mix none=40,...] [--min-time SECONDS]
+//
+// times the engine on synthetic ledgers instead and prints JSON (see ledgerbenchmark.h).
+//
+//   moneycalendar-cli --verify [--seed N] [--ledgers N] [FILE...]
+//
+// compares the engine against a plain reference on random ledgers, and checks
+// each FILE as a fuzz input, then prints JSON and fails if anything disagreed
+// (see ledgerverifier.h). Worth running in a build made with
+// CONFIG += sanitizer sanitize_address sanitize_undefined.
+//
+// --trace FILE additionally writes a Chrome trace of the run, in builds made
+// with CONFIG += instrumentation (see instrumentation.h).
+#include "instrumentation.h"
+#include "ledger.h"
+#include "ledgerbenchmark.h"
+#include "ledgerverifier.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QTextStream>
+
+static QDate parseDate(const QString &text, const QDate &fallback) {
+    return text.isEmpty() ? fallback : QDate::fromString(text, Qt::ISODate);
+}
+
+// --stream writes each batch of days as it is computed; otherwise the whole
+// range goes through the ledger's balance timeline first
+static void writeCsv(Ledger &ledger, const QDate &from, const QDate &to, bool stream,
+                     const QString &label, QTextStream &out) {
+    QString prefix = label.isEmpty() ? QString() : label + ",";
+
+    if (stream) {
+        ledger.project(from, to, [&](const QDate &date, Money balance, Money net) {
+            out << prefix << date.toString(Qt::ISODate) << ',' << balance.toString() << ',' << net.toString() << '\n';
+            if (date.dayOfWeek() == 7) out.flush();
+            return out.status() == QTextStream::Ok;
+        });
+        out.flush();
+        return;
+    }
+
+    ledger.cacheRange(from, to);
+    for (QDate date = from; date <= to; date = date.addDays(1)) {
+        out << prefix << date.toString(Qt::ISODate) << ',' << ledger.balanceOn(date).toString()
+            << ',' << ledger.netOn(date).toString() << '\n';
+    }
+    out.flush();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("moneycalendar-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Prints the projected daily balance and net change of ledgers as CSV.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("ledger", "Ledger folder or snapshot file (.json / .mcl).", "LEDGER...");
+
+    QCommandLineOption fromOption("from", "First day (yyyy-MM-dd), default today.", "date");
+    QCommandLineOption toOption("to", "Last day (yyyy-MM-dd), default one year after --from.", "date");
+    QCommandLineOption streamOption("stream", "Write rows as they are computed, for ranges of many years.");
+    QCommandLineOption outputOption("output-dir", "Write <ledger name>.csv per ledger into dir instead of stdout.", "dir");
+    parser.addOptions({ fromOption, toOption, streamOption, outputOption });
+
+    QCommandLineOption benchmarkOption("benchmark", "Time the engine on synthetic ledgers and print JSON.");
+    QCommandLineOption sizesOption("sizes", "Benchmark ledger sizes, default 100,1000,10000,100000,1000000.", "n,...");
+    QCommandLineOption mixOption("mix", "Benchmark recurrence mix, default none=40,weekly=20,biweekly=10,monthly=20,everyn=10.", "mix");
+    QCommandLineOption minTimeOption("min-time", "Minimum seconds per benchmark, default 0.5.", "seconds", "0.5");
+    parser.addOptions({ benchmarkOption, sizesOption, mixOption, minTimeOption });
+
+    QCommandLineOption verifyOption("verify", "Compare the engine against a reference on random ledgers and print JSON.");
+    QCommandLineOption seedOption("seed", "Seed of the random ledgers, default 1.", "n", "1");
+    QCommandLineOption ledgersOption("ledgers", "Random ledgers to check, default 200.", "n", "200");
+    parser.addOptions({ verifyOption, seedOption, ledgersOption });
+
+    QCommandLineOption traceOption("trace", "Write a Chrome trace of the run to file (instrumented builds only).", "file");
+    parser.addOption(traceOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    QString tracePath = parser.value(traceOption);
+    if (!tracePath.isEmpty()) {
+        if (!Instrumentation::isEnabled()) {
+            err << "--trace needs a build with CONFIG+=instrumentation\n";
+            return 1;
+        }
+        Instrumentation::setTracing(true);
+    }
+    // Written however main() returns
+    struct TraceWriter {
+        QString path;
+        ~TraceWriter() {
+            if (!path.isEmpty()) Instrumentation::writeChromeTrace(path);
+        }
+    } traceWriter{ tracePath };
+    if (parser.isSet(verifyOption)) {
+        bool ok = false;
+        quint32 seed = parser.value(seedOption).toUInt(&ok);
+        int count = ok ? parser.value(ledgersOption).toInt(&ok) : 0;
+        if (!ok || count < 0) {
+            err << "Invalid --seed or --ledgers\n";
+            return 1;
+        }
+
+        LedgerVerifier::Report report = LedgerVerifier::run(seed, count);
+        for (const QString &path : parser.positionalArguments()) {
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly)) {
+                err << "Could not read " << path << '\n';
+                return 1;
+            }
+            LedgerVerifier::checkSnapshot(file.readAll(), report);
+        }
+        QTextStream(stdout) << QJsonDocument(report.toJson()).toJson(QJsonDocument::Indented);
+        return report.ok() ? 0 : 1;
+    }
+
+    if (parser.isSet(benchmarkOption)) {
+        QVector<int> sizes = { 100, 1000, 10000, 100000, 1000000 };
+        if (parser.isSet(sizesOption)) {
+            sizes.clear();
+            for (const QString &text : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+                bool ok = false;
+                int size = text.toInt(&ok);
+                if (!ok || size <= 0) {
+                    err << "Invalid ledger size " << text << '\n';
+                    return 1;
+                }
+                sizes.append(size);
+            }
+        }
+
+        LedgerBenchmark::Mix mix;
+        if (parser.isSet(mixOption) && !LedgerBenchmark::Mix::parse(parser.value(mixOption), mix)) {
+            err << "Invalid recurrence mix " << parser.value(mixOption) << '\n';
+            return 1;
+        }
+
+        bool ok = false;
+        double minSeconds = parser.value(minTimeOption).toDouble(&ok);
+        if (!ok || minSeconds < 0) {
+            err << "Invalid --min-time\n";
+            return 1;
+        }
+
+        QJsonObject results = LedgerBenchmark::run(sizes, mix, minSeconds);
+        QTextStream(stdout) << QJsonDocument(results).toJson(QJsonDocument::Indented);
+        return 0;
+    }
+
+    QStringList ledgers = parser.positionalArguments();
+    if (ledgers.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    QDate from = parseDate(parser.value(fromOption), QDate::currentDate());
+    QDate to = parseDate(parser.value(toOption), from.addYears(1).addDays(-1));
+    if (!from.isValid() || !to.isValid() || to < from) {
+        err << "Invalid date range\n";
+        return 1;
+    }
+
+    QString outputDir = parser.value(outputOption);
+    if (!outputDir.isEmpty() && !QDir().mkpath(outputDir)) {
+        err << "Could not create " << outputDir << '\n';
+        return 1;
+    }
+
+    // Several ledgers on stdout share one table with a leading ledger column
+    bool labelRows = outputDir.isEmpty() && ledgers.size() > 1;
+    QTextStream stdOut(stdout);
+    if (outputDir.isEmpty()) {
+        stdOut << (labelRows ? "ledger," : "") << "date,balance,net\n";
+    }
+
+    int failures = 0;
+    for (const QString &path : ledgers) {
+        QFileInfo info(path);
+        Ledger ledger(path, true);
+        if (!info.exists() || !ledger.load()) {
+            err << "Could not load ledger " << path << '\n';
+            ++failures;
+            continue;
+        }
+        ledger.showArchive(from, to);   // archived years in the range, row by row
+
+        QString name = info.isDir() ? QDir(path).dirName() : info.completeBaseName();
+        if (outputDir.isEmpty()) {
+            writeCsv(ledger, from, to, parser.isSet(streamOption), labelRows ? name : QString(), stdOut);
+            continue;
+        }
+
+        QFile file(QDir(outputDir).filePath(name + ".csv"));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            err << "Could not write " << file.fileName() << ": " << file.errorString() << '\n';
+            ++failures;
+            continue;
+        }
+        QTextStream out(&file);
+        out << "date,balance,net\n";
+        writeCsv(ledger, from, to, parser.isSet(streamOption), QString(), out);
+        if (out.status() != QTextStream::Ok) {
+            err << "Could not write " << file.fileName() << '\n';
+            ++failures;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
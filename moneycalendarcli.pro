@@ -0,0 +1,32 @@
+QT = core
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+TARGET = moneycalendar-cli
+
+include(moneycalendarengine.pri)
+
+SOURCES += \
+    ledgerbenchmark.cpp \
+    ledgerverifier.cpp \
+    moneycalendarcli.cpp
+
+HEADERS += \
+    ledgerbenchmark.h \
+    ledgerverifier.h
+
+# qmake CONFIG+=fuzz (clang) builds the libFuzzer target moneycalendar-fuzz
+# instead of the command-line tool, with sanitizers (see ledgerfuzz.cpp)
+fuzz {
+    TARGET = moneycalendar-fuzz
+    SOURCES -= moneycalendarcli.cpp
+    SOURCES += ledgerfuzz.cpp
+    CONFIG += sanitizer sanitize_address sanitize_undefined
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer
+    QMAKE_LFLAGS += -fsanitize=fuzzer
+}
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
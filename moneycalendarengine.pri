@@ -0,0 +1,15 @@
+# Links the engine library built by moneycalendarengine.pro (same build folder)
+QT += concurrent
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+win32:CONFIG(release, debug|release): ENGINE_LIB_DIR = $$OUT_PWD/release
+else:win32:CONFIG(debug, debug|release): ENGINE_LIB_DIR = $$OUT_PWD/debug
+else: ENGINE_LIB_DIR = $$OUT_PWD
+
+instrumentation: DEFINES += MONEYCALENDAR_INSTRUMENTATION
+
+LIBS += -L$$ENGINE_LIB_DIR -lmoneycalendarengine
+
+win32-g++|!win32: PRE_TARGETDEPS += $$ENGINE_LIB_DIR/libmoneycalendarengine.a
+else: PRE_TARGETDEPS += $$ENGINE_LIB_DIR/moneycalendarengine.lib
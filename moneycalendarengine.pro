@@ -0,0 +1,53 @@
+QT = core concurrent
+
+TEMPLATE = lib
+CONFIG += staticlib c++17
+TARGET = moneycalendarengine
+
+# qmake CONFIG+=instrumentation builds the timers and counters in (see instrumentation.h)
+instrumentation: DEFINES += MONEYCALENDAR_INSTRUMENTATION
+
+# qmake CONFIG+=fuzz instruments the engine for the fuzz target (see ledgerfuzz.cpp)
+fuzz {
+    CONFIG += sanitizer sanitize_address sanitize_undefined
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer-no-link
+}
+
+# You can make your code fail to compile if it uses deprecated APIs.
+# In order to do so, uncomment the following line.
+#DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
+
+SOURCES += \
+    balancekernels.cpp \
+    balancetimeline.cpp \
+    eventlistmodel.cpp \
+    instrumentation.cpp \
+    ledger.cpp \
+    ledgerarchive.cpp \
+    ledgerbinary.cpp \
+    ledgerjournal.cpp \
+    money.cpp \
+    occurrenceindex.cpp \
+    projectionservice.cpp \
+    recurrence.cpp \
+    statementreader.cpp \
+    transactionstore.cpp \
+    workspace.cpp
+
+HEADERS += \
+    balancekernels.h \
+    balancetimeline.h \
+    eventlistmodel.h \
+    instrumentation.h \
+    ledger.h \
+    ledgerarchive.h \
+    ledgerbinary.h \
+    ledgerjournal.h \
+    money.h \
+    occurrenceindex.h \
+    projectionservice.h \
+    recurrence.h \
+    statementreader.h \
+    transaction.h \
+    transactionstore.h \
+    workspace.h
@@ -0,0 +1,24 @@
+QT = core testlib
+
+CONFIG += console c++17 testcase
+CONFIG -= app_bundle
+TARGET = moneycalendar-tests
+
+include(moneycalendarengine.pri)
+
+# `make check` runs every test class (see tst_main.cpp); each one can also be
+# picked on its own: moneycalendar-tests RecurrenceTest
+SOURCES += \
+    ledgerverifier.cpp \
+    tst_main.cpp \
+    tst_balancetimeline.cpp \
+    tst_ledger.cpp \
+    tst_ledgerjournal.cpp \
+    tst_ledgerverifier.cpp \
+    tst_money.cpp \
+    tst_recurrence.cpp \
+    tst_statementreader.cpp
+
+HEADERS += \
+    ledgerverifier.h \
+    tst_support.h
@@ -0,0 +1,18 @@
+QT += widgets
+
+CONFIG += console c++17
+CONFIG -= app_bundle
+TARGET = moneycalendar-widgetbench
+
+include(moneycalendarengine.pri)
+
+# Times the calendar widget's repaints on the offscreen platform (see
+# widgetbenchmark.cpp); not installed
+SOURCES += \
+    customcalendar.cpp \
+    ledgerbenchmark.cpp \
+    widgetbenchmark.cpp
+
+HEADERS += \
+    customcalendar.h \
+    ledgerbenchmark.h
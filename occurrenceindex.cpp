@@ -0,0 +1,181 @@
+// occurrenceindex.cpp
+#include "occurrenceindex.h"
+#include "instrumentation.h"
+#include "recurrence.h"
+
+#include <algorithm>
+
+static int phaseOf(qint64 julianDay, int period) {
+    return int(((julianDay % period) + period) % period);
+}
+
+quint64 OccurrenceIndex::monthlyKey(int dayOfMonth, int interval, int phase) {
+    return (quint64(dayOfMonth) << 48) | (quint64(interval) << 24) | quint64(phase);
+}
+
+void OccurrenceIndex::clear() {
+    oneTime.clear();
+    for (auto &bucket : weekly) bucket.clear();
+    for (auto &bucket : biWeekly) bucket.clear();
+    monthly.clear();
+    rules.clear();
+    monthlyIntervals.clear();
+    positions.clear();
+}
+
+void OccurrenceIndex::rebuild(const TransactionStore &store) {
+    clear();
+    store.forEachSchedule([this](const Transaction &trans) { insert(trans); });
+}
+
+OccurrenceIndex::Bucket *OccurrenceIndex::bucketFor(const Transaction &trans, bool create) {
+    qint64 startDay = trans.startDate.toJulianDay();
+    auto lookup = [create](auto &buckets, auto key) -> Bucket * {
+        if (create) return &buckets[key];
+        auto found = buckets.find(key);
+        return (found == buckets.end()) ? nullptr : &found.value();
+    };
+
+    switch (trans.recurrence) {
+    case RecurrenceType::None:
+        return lookup(oneTime, startDay);
+    case RecurrenceType::Weekly:
+        return &weekly[phaseOf(startDay, 7)];
+    case RecurrenceType::BiWeekly:
+        return &biWeekly[phaseOf(startDay, 14)];
+    case RecurrenceType::Monthly:
+    case RecurrenceType::EveryNMonths:
+    {
+        int interval = Recurrence::intervalOf(trans);
+        int phase = phaseOf(Recurrence::monthIndex(trans.startDate), interval);
+        return lookup(monthly, monthlyKey(trans.startDate.day(), interval, phase));
+    }
+    }
+    return nullptr;
+}
+
+void OccurrenceIndex::insert(const Transaction &trans) {
+    if (!trans.startDate.isValid()) return;
+
+    if (Recurrence::needsRule(trans)) {
+        positions.insert(trans.id, int(rules.size()));
+        rules.append(RuleEntry{ trans.id, trans.amount, Recurrence::Rule::compile(trans) });
+        return;
+    }
+
+    Bucket *bucket = bucketFor(trans, true);
+    if (!bucket) return;
+    positions.insert(trans.id, int(bucket->size()));
+    bucket->append(Entry{ trans.id, trans.startDate.toJulianDay(), trans.amount });
+
+    if (trans.recurrence == RecurrenceType::Monthly || trans.recurrence == RecurrenceType::EveryNMonths) {
+        ++monthlyIntervals[Recurrence::intervalOf(trans)];
+    }
+}
+
+void OccurrenceIndex::remove(const Transaction &trans) {
+    if (!trans.startDate.isValid()) return;
+
+    if (Recurrence::needsRule(trans)) {
+        int i = positions.value(trans.id, -1);
+        if (i < 0 || i >= rules.size() || rules.at(i).id != trans.id) return;
+        positions.remove(trans.id);
+        if (i != rules.size() - 1) {
+            rules[i] = rules.last();
+            positions[rules.at(i).id] = i;
+        }
+        rules.removeLast();
+        return;
+    }
+
+    // Only ever looked up here: removing something that isn't indexed
+    // changes nothing, not even an empty bucket left behind
+    Bucket *bucket = bucketFor(trans, false);
+    if (!bucket) return;
+
+    auto position = positions.constFind(trans.id);
+    if (position == positions.constEnd()) return;
+    int i = position.value();
+    if (i >= bucket->size() || bucket->at(i).id != trans.id) return;
+    positions.remove(trans.id);
+
+    // Swap-and-pop; lookups sort their results, so bucket order doesn't matter
+    if (i != bucket->size() - 1) {
+        (*bucket)[i] = bucket->last();
+        positions[bucket->at(i).id] = i;
+    }
+    bucket->removeLast();
+
+    if (trans.recurrence == RecurrenceType::None && bucket->isEmpty()) {
+        oneTime.remove(trans.startDate.toJulianDay());
+    } else if (trans.recurrence == RecurrenceType::Monthly || trans.recurrence == RecurrenceType::EveryNMonths) {
+        int interval = Recurrence::intervalOf(trans);
+        if (--monthlyIntervals[interval] <= 0) {
+            monthlyIntervals.remove(interval);
+        }
+    }
+}
+
+template <typename Visitor>
+void OccurrenceIndex::visitOn(const QDate &date, Visitor visit) const {
+    if (!date.isValid()) return;
+
+    qint64 day = date.toJulianDay();
+
+    auto visitStarted = [&](const Bucket &bucket) {
+        MC_COUNT(TransactionsScanned, bucket.size());
+        for (const auto &entry : bucket) {
+            if (entry.startDay <= day) visit(entry);
+        }
+    };
+
+    auto found = oneTime.constFind(day);
+    if (found != oneTime.constEnd()) {
+        visitStarted(found.value());
+    }
+    visitStarted(weekly[phaseOf(day, 7)]);
+    visitStarted(biWeekly[phaseOf(day, 14)]);
+
+    MC_COUNT(TransactionsScanned, rules.size());
+    MC_COUNT(OccurrencesEvaluated, rules.size());
+    for (const auto &entry : rules) {
+        if (entry.rule.occursOn(day)) visit(Entry{ entry.id, day, entry.amount });
+    }
+
+    if (monthly.isEmpty()) return;
+
+    // On the last day of a month, items scheduled for the 29th-31st land here too
+    int month = Recurrence::monthIndex(date);
+    int lastDay = (date.day() == date.daysInMonth()) ? 31 : date.day();
+    for (auto it = monthlyIntervals.constBegin(); it != monthlyIntervals.constEnd(); ++it) {
+        int interval = it.key();
+        int phase = phaseOf(month, interval);
+        for (int dayOfMonth = date.day(); dayOfMonth <= lastDay; ++dayOfMonth) {
+            auto bucket = monthly.constFind(monthlyKey(dayOfMonth, interval, phase));
+            if (bucket != monthly.constEnd()) {
+                visitStarted(bucket.value());
+            }
+        }
+    }
+}
+
+QVector<int> OccurrenceIndex::transactionsOn(const QDate &date) const {
+    QVector<int> ids;
+    transactionsOn(date, ids);
+    return ids;
+}
+
+void OccurrenceIndex::transactionsOn(const QDate &date, QVector<int> &ids) const {
+    MC_TRACE_SCOPE("OccurrenceIndex::transactionsOn");
+    ids.clear();
+    visitOn(date, [&](const Entry &entry) { ids.append(entry.id); });
+
+    std::sort(ids.begin(), ids.end());
+}
+
+Money OccurrenceIndex::netAmountOn(const QDate &date) const {
+    MC_TRACE_SCOPE("OccurrenceIndex::netAmountOn");
+    Money net;
+    visitOn(date, [&](const Entry &entry) { net += entry.amount; });
+    return net;
+}
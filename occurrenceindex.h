@@ -0,0 +1,62 @@
+// occurrenceindex.h
+#ifndef OCCURRENCEINDEX_H
+#define OCCURRENCEINDEX_H
+
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QDate>
+
+#include "transactionstore.h"
+
+// Buckets transactions by the dates they can fall on, so asking "what happens
+// on this day" only touches the transactions that actually happen on it:
+//   - one-time items by Julian day
+//   - weekly / bi-weekly items by their 7 / 14 day phase
+//   - monthly items by (day of month, interval, month phase)
+//   - items with a Recurrence::Rule in one list, each asked directly
+// Kept up to date with insert()/remove() instead of being rebuilt; both are
+// O(1), a removal moves the bucket's last entry into the gap.
+class OccurrenceIndex {
+public:
+    void clear();
+    void rebuild(const TransactionStore &store);
+    void insert(const Transaction &trans);
+    void remove(const Transaction &trans);
+
+    // Ids of the transactions falling on date, sorted by id
+    QVector<int> transactionsOn(const QDate &date) const;
+    void transactionsOn(const QDate &date, QVector<int> &ids) const;   // reuses ids' capacity
+    Money netAmountOn(const QDate &date) const;
+
+private:
+    // Just what a lookup needs; the rest is in the TransactionStore
+    struct Entry {
+        int id;
+        qint64 startDay;
+        Money amount;
+    };
+    typedef QVector<Entry> Bucket;
+
+    struct RuleEntry {
+        int id;
+        Money amount;
+        Recurrence::Rule rule;
+    };
+
+    // create: make the bucket if it doesn't exist yet; otherwise null then
+    Bucket *bucketFor(const Transaction &trans, bool create);
+    template <typename Visitor> void visitOn(const QDate &date, Visitor visit) const;
+
+    static quint64 monthlyKey(int dayOfMonth, int interval, int phase);
+
+    QHash<qint64, Bucket> oneTime;      // Julian day -> items
+    Bucket weekly[7];                   // Julian day % 7
+    Bucket biWeekly[14];                // Julian day % 14
+    QHash<quint64, Bucket> monthly;     // monthlyKey()
+    QVector<RuleEntry> rules;
+    QMap<int, int> monthlyIntervals;    // interval -> number of items using it
+    QHash<int, int> positions;          // id -> position in its bucket (or rules)
+};
+
+#endif // OCCURRENCEINDEX_H
@@ -0,0 +1,188 @@
+// projectionservice.cpp
+#include "projectionservice.h"
+#include "balancekernels.h"
+#include "instrumentation.h"
+#include "recurrence.h"
+
+#include <QtConcurrent>
+
+#include <algorithm>
+
+ProjectionService::ProjectionService(QObject *parent) : QObject(parent) {
+    connect(&watcher, &QFutureWatcher<Projection>::finished, this, &ProjectionService::onFinished);
+}
+
+ProjectionService::~ProjectionService() {
+    ++newest;   // tells a running job to stop at its next batch
+    watcher.waitForFinished();
+}
+
+void ProjectionService::request(const LedgerSnapshot &snapshot, const QDate &from, const QDate &to,
+                                const QVector<QDate> &dates) {
+    if (!snapshot) return;
+    request(QVector<LedgerSnapshot>{ snapshot }, from, to, dates);
+}
+
+void ProjectionService::request(const QVector<LedgerSnapshot> &snapshots, const QDate &from, const QDate &to,
+                                const QVector<QDate> &dates) {
+    if (snapshots.isEmpty() || snapshots.contains(LedgerSnapshot())) return;
+
+    Job job{ snapshots, from, to, dates, ++newest };
+    requestedFrom = from;
+    requestedTo = to;
+    requestedDates = dates;
+
+    // The running job notices newest moved on; this one starts when it returns
+    if (running) {
+        pending = job;
+        hasPending = true;
+        return;
+    }
+    start(job);
+}
+
+bool ProjectionService::isRequested(const QDate &from, const QDate &to, const QVector<QDate> &dates) const {
+    if (newest == 0 || from < requestedFrom || to > requestedTo) return false;
+
+    for (const QDate &date : dates) {
+        bool inRange = date >= requestedFrom && date <= requestedTo;
+        if (!inRange && !requestedDates.contains(date)) return false;
+    }
+    return true;
+}
+
+bool ProjectionService::useRecent(const QVector<LedgerSnapshot> &snapshots, const QDate &from, const QDate &to,
+                                  const QVector<QDate> &dates) {
+    if (snapshots.contains(LedgerSnapshot())) return false;
+    QVector<QPair<quint64, quint64>> versions;
+    for (const LedgerSnapshot &snapshot : snapshots) {
+        versions.append(qMakePair(snapshot->ledger, snapshot->version));
+    }
+
+    auto covers = [&](const Projection &projection) {
+        if (projection.versions != versions || !projection.timeline.isValid()
+            || !projection.timeline.covers(from) || !projection.timeline.covers(to)) {
+            return false;
+        }
+        for (const QDate &date : dates) {
+            if (!projection.timeline.covers(date) && !projection.balances.contains(date)) return false;
+        }
+        return true;
+    };
+    if (covers(current)) return true;
+
+    for (const Projection &projection : recent) {
+        if (!covers(projection)) continue;
+        Projection found = projection;
+        remember(current);   // may hold an edit no finished projection has
+        current = found;
+        return true;
+    }
+    return false;
+}
+
+void ProjectionService::remember(const Projection &projection) {
+    if (!projection.timeline.isValid()) return;
+    for (const Projection &kept : recent) {
+        if (kept.versions == projection.versions && kept.timeline.firstDate() == projection.timeline.firstDate()
+            && kept.timeline.lastDate() == projection.timeline.lastDate()) {
+            return;   // already kept
+        }
+    }
+    if (recent.size() < RecentCount) {
+        recent.append(projection);
+    } else {
+        recent[nextRecent] = projection;
+    }
+    nextRecent = (nextRecent + 1) % RecentCount;
+}
+
+bool ProjectionService::applyEdit(const QVector<Transaction> &changed, int sign, const LedgerSnapshot &edited) {
+    if (running || hasPending || !current.timeline.isValid() || !edited) return false;
+
+    auto source = std::find_if(current.versions.begin(), current.versions.end(), [&](const QPair<quint64, quint64> &v) {
+        return v.first == edited->ledger;
+    });
+    if (source == current.versions.end() || source->second + 1 != edited->version) return false;
+
+    for (const Transaction &trans : changed) {
+        current.timeline.apply(trans, sign);
+
+        Recurrence::Rule rule = Recurrence::Rule::compile(trans);
+        Money amount = (sign < 0) ? -trans.amount : trans.amount;
+        for (auto it = current.balances.begin(); it != current.balances.end(); ++it) {
+            it.value() += amount * rule.countUpTo(it.key().toJulianDay());
+        }
+    }
+    source->second = edited->version;
+    return true;
+}
+
+void ProjectionService::start(const Job &job) {
+    running = true;
+    runningGeneration = job.generation;
+    watcher.setFuture(QtConcurrent::run(&ProjectionService::run, job, &newest));
+}
+
+void ProjectionService::onFinished() {
+    running = false;
+
+    if (runningGeneration == newest) {
+        current = watcher.result();
+        remember(current);
+        emit projectionReady();
+    }
+
+    if (hasPending) {
+        hasPending = false;
+        Job job = pending;
+        pending = Job();   // don't keep an old version alive
+        start(job);
+    }
+}
+
+// Runs on the thread pool
+ProjectionService::Projection ProjectionService::run(const Job &job, const std::atomic<quint64> *newest) {
+    MC_TRACE_SCOPE("ProjectionService::run");
+    auto superseded = [&] { return *newest != job.generation; };
+
+    BalanceKernels::Target targets[BalanceKernels::MaxBatch];
+    QVector<QDate> dates;
+    for (const QDate &date : job.dates) {
+        if (!date.isValid() || dates.size() == BalanceKernels::MaxBatch) continue;
+        targets[dates.size()] = BalanceKernels::Target::fromDate(date);
+        dates.append(date);
+    }
+
+    // One store at a time (each ledger's, and its archive's), each one's
+    // series added onto the first
+    Projection result;
+    BalanceTimeline part;
+    bool first = true;
+    for (const LedgerSnapshot &snapshot : job.snapshots) {
+        for (const TransactionStore *store : { &snapshot->store, &snapshot->archived }) {
+            if (store->isEmpty() && !first) continue;
+
+            BalanceTimeline &timeline = first ? result.timeline : part;
+            if (!timeline.rebuild(*store, job.from, job.to, superseded)) {
+                result.timeline.invalidate();
+                return result;
+            }
+            if (!first) {
+                result.timeline.add(part);
+            }
+            first = false;
+
+            Money balances[BalanceKernels::MaxBatch];
+            Money nets[BalanceKernels::MaxBatch];
+            if (!dates.isEmpty() && !superseded()) {
+                BalanceKernels::project(*store, targets, int(dates.size()), balances, nets);
+                for (int i = 0; i < dates.size(); ++i) {
+                    result.balances[dates[i]] += balances[i];
+                }
+            }
+        }
+        result.versions.append(qMakePair(snapshot->ledger, snapshot->version));
+    }
+    return result;
+}
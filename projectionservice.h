@@ -0,0 +1,95 @@
+// projectionservice.h
+#ifndef PROJECTIONSERVICE_H
+#define PROJECTIONSERVICE_H
+
+#include <QDate>
+#include <QFutureWatcher>
+#include <QMap>
+#include <QObject>
+#include <QVector>
+
+#include <atomic>
+
+#include "balancetimeline.h"
+#include "ledger.h"
+#include "money.h"
+
+// Builds balance timelines on the thread pool so the calendar never waits for
+// a projection. Each request works on immutable ledger snapshots, so the
+// ledgers can keep changing meanwhile, and a newer request makes a running one stop
+// at its next batch. Only the newest request's result is ever delivered.
+// Several ledgers are projected one after another and summed day by day.
+class ProjectionService : public QObject {
+    Q_OBJECT
+
+public:
+    struct Projection {
+        BalanceTimeline timeline;          // daily balance / net over the requested range
+        QMap<QDate, Money> balances;       // balance on each extra date asked for
+        QVector<QPair<quint64, quint64>> versions;   // (ledger, version) of each LedgerVersion summed
+    };
+
+    explicit ProjectionService(QObject *parent = nullptr);
+    ~ProjectionService();
+
+    // Project from..to, plus the balance on each of dates (at most
+    // BalanceKernels::MaxBatch), e.g. labels outside the range
+    void request(const LedgerSnapshot &snapshot, const QDate &from, const QDate &to,
+                 const QVector<QDate> &dates = {});
+    void request(const QVector<LedgerSnapshot> &snapshots, const QDate &from, const QDate &to,
+                 const QVector<QDate> &dates = {});
+
+    // Brings the latest projection up to edited by adding (sign 1) or taking
+    // out (sign -1) the given transactions, for an add or delete, instead of
+    // projecting the whole ledger again. Only possible while latest() includes
+    // the version just before edited and nothing is being projected; returns
+    // false otherwise, and then the caller needs a fresh request().
+    bool applyEdit(const QVector<Transaction> &changed, int sign, const LedgerSnapshot &edited);
+
+    // Whether the newest request, finished or not, includes from..to and dates
+    bool isRequested(const QDate &from, const QDate &to, const QVector<QDate> &dates = {}) const;
+
+    // Makes a recently finished projection of exactly these ledger versions
+    // the latest one if it covers from..to and dates, e.g. a page the user
+    // paged back to; it then paints at once while a request() for the whole
+    // range around it runs. Doesn't emit projectionReady().
+    bool useRecent(const QVector<LedgerSnapshot> &snapshots, const QDate &from, const QDate &to,
+                   const QVector<QDate> &dates = {});
+
+    // Newest finished projection; empty until the first one arrives, and
+    // possibly older than the ledger until projectionReady() follows a request
+    const Projection &latest() const { return current; }
+
+signals:
+    void projectionReady();
+
+private:
+    struct Job {
+        QVector<LedgerSnapshot> snapshots;
+        QDate from, to;
+        QVector<QDate> dates;
+        quint64 generation = 0;
+    };
+
+    void start(const Job &job);
+    void onFinished();
+    static Projection run(const Job &job, const std::atomic<quint64> *newest);
+
+    QFutureWatcher<Projection> watcher;
+    std::atomic<quint64> newest{0};   // generation of the latest request
+    quint64 runningGeneration = 0;
+    bool running = false;
+    bool hasPending = false;
+    Job pending;                      // starts once the superseded job has stopped
+    QDate requestedFrom, requestedTo;
+    QVector<QDate> requestedDates;
+    Projection current;
+
+    // Ring buffer of the last few finished projections, see useRecent()
+    static constexpr int RecentCount = 6;
+    void remember(const Projection &projection);
+    QVector<Projection> recent;
+    int nextRecent = 0;               // slot the next one overwrites
+};
+
+#endif // PROJECTIONSERVICE_H
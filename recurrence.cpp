@@ -0,0 +1,297 @@
+// recurrence.cpp
+#include "recurrence.h"
+
+#include <QLocale>
+
+#include <numeric>
+
+bool Recurrence::needsRule(const Transaction &trans) {
+    switch (trans.recurrence) {
+    case RecurrenceType::EveryNDays:
+    case RecurrenceType::NthWeekday:
+    case RecurrenceType::LastBusinessDay:
+        return true;
+    case RecurrenceType::Monthly:
+    case RecurrenceType::EveryNMonths:
+        if (trans.startDate.isValid() && trans.startDate.day() > 28) return true;
+        break;
+    default:
+        break;
+    }
+    return trans.endDate.isValid() || trans.occurrenceLimit > 0;
+}
+
+// Length of a month given as a monthIndex()
+static int daysInMonth(int month) {
+    return QDate(month / 12, month % 12 + 1, 1).daysInMonth();
+}
+
+namespace Recurrence {
+
+// Every kind answers, ignoring end date and limit: how many occurrences up to
+// a day, whether one falls on a day, and the day of the n-th
+struct RuleKinds {
+    struct Never {
+        static int count(const Rule &, qint64) { return 0; }
+        static bool on(const Rule &, qint64) { return false; }
+        static qint64 nth(const Rule &rule, int) { return rule.startDay; }
+    };
+
+    struct Once {
+        static int count(const Rule &rule, qint64 day) { return day >= rule.startDay; }
+        static bool on(const Rule &rule, qint64 day) { return day == rule.startDay; }
+        static qint64 nth(const Rule &rule, int) { return rule.startDay; }
+    };
+
+    struct EveryNDays {
+        static int count(const Rule &rule, qint64 day) {
+            return day < rule.startDay ? 0 : int((day - rule.startDay) / rule.interval) + 1;
+        }
+        static bool on(const Rule &rule, qint64 day) {
+            return day >= rule.startDay && (day - rule.startDay) % rule.interval == 0;
+        }
+        static qint64 nth(const Rule &rule, int n) { return rule.startDay + qint64(n) * rule.interval; }
+    };
+
+    // Where in a month (a monthIndex) the occurrence falls
+    struct DayOfMonth {
+        static qint64 day(const Rule &rule, int month) {
+            int dayOfMonth = rule.dayOfMonth;
+            for (int i = 0; i < rule.clamps && month >= rule.clampMonth[i]; ++i) {
+                dayOfMonth = rule.clampDay[i];
+            }
+            QDate first(month / 12, month % 12 + 1, 1);
+            return first.toJulianDay() + qMin(dayOfMonth, first.daysInMonth()) - 1;
+        }
+
+        // Steps through the schedule's months once, the way addMonths()
+        // would, noting where a shorter month cuts the day back. Month
+        // lengths repeat every 4800 months, so once every step has been seen
+        // modulo that, no later month can cut it further.
+        static void findClamps(Rule &rule) {
+            int steps = 4800 / std::gcd(rule.interval, 4800);
+            int dayOfMonth = rule.dayOfMonth;
+            for (int step = 1; step <= steps && dayOfMonth > 28; ++step) {
+                int month = rule.startMonth + step * rule.interval;
+                if (daysInMonth(month) < dayOfMonth) {
+                    dayOfMonth = daysInMonth(month);
+                    rule.clampMonth[rule.clamps] = month;
+                    rule.clampDay[rule.clamps] = dayOfMonth;
+                    ++rule.clamps;
+                }
+            }
+        }
+    };
+
+    struct NthWeekday {
+        static qint64 day(const Rule &rule, int month) {
+            QDate first(month / 12, month % 12 + 1, 1);
+            if (rule.week > 0) {
+                int ahead = (rule.weekday - first.dayOfWeek() + 7) % 7;
+                return first.toJulianDay() + ahead + 7 * (rule.week - 1);
+            }
+            qint64 last = first.toJulianDay() + first.daysInMonth() - 1;
+            int back = (QDate::fromJulianDay(last).dayOfWeek() - rule.weekday + 7) % 7;
+            return last - back;
+        }
+    };
+
+    struct LastBusinessDay {
+        static qint64 day(const Rule &, int month) {
+            QDate first(month / 12, month % 12 + 1, 1);
+            qint64 last = first.toJulianDay() + first.daysInMonth() - 1;
+            int weekday = QDate::fromJulianDay(last).dayOfWeek();
+            return last - (weekday == 6 ? 1 : weekday == 7 ? 2 : 0);
+        }
+    };
+
+    // One occurrence in every interval-th month from the start month on
+    template <typename DayIn>
+    struct Months {
+        static int count(const Rule &rule, qint64 day) {
+            if (day < rule.startDay) return 0;
+            int month = monthIndex(QDate::fromJulianDay(day));
+            int last = (month - rule.startMonth) / rule.interval;
+            if (DayIn::day(rule, rule.startMonth + last * rule.interval) > day) --last;
+            return qMax(0, last - rule.skipFirst + 1);
+        }
+        static bool on(const Rule &rule, qint64 day) {
+            if (day < rule.startDay) return false;
+            int month = monthIndex(QDate::fromJulianDay(day));
+            return (month - rule.startMonth) % rule.interval == 0 && DayIn::day(rule, month) == day;
+        }
+        static qint64 nth(const Rule &rule, int n) {
+            return DayIn::day(rule, rule.startMonth + (n + rule.skipFirst) * rule.interval);
+        }
+    };
+
+    // A kind plus, if Bounded, the end date and occurrence limit
+    template <typename Kind, bool Bounded>
+    struct Evaluator {
+        static int count(const Rule &rule, qint64 day) {
+            if constexpr (!Bounded) {
+                return Kind::count(rule, day);
+            } else {
+                int n = Kind::count(rule, qMin(day, rule.endDay));
+                return rule.limit > 0 ? qMin(n, rule.limit) : n;
+            }
+        }
+        static bool on(const Rule &rule, qint64 day) {
+            if constexpr (!Bounded) {
+                return Kind::on(rule, day);
+            } else {
+                return day <= rule.endDay && Kind::on(rule, day)
+                       && (rule.limit <= 0 || Kind::count(rule, day) <= rule.limit);
+            }
+        }
+    };
+
+    template <typename Kind>
+    static void select(Rule &rule, bool bounded) {
+        rule.countFn = bounded ? &Evaluator<Kind, true>::count : &Evaluator<Kind, false>::count;
+        rule.onFn = bounded ? &Evaluator<Kind, true>::on : &Evaluator<Kind, false>::on;
+        rule.nthFn = &Kind::nth;
+    }
+
+    template <typename DayIn>
+    static void selectMonths(Rule &rule, bool bounded) {
+        select<Months<DayIn>>(rule, bounded);
+        rule.skipFirst = DayIn::day(rule, rule.startMonth) < rule.startDay;
+    }
+};
+
+} // namespace Recurrence
+
+Recurrence::Rule Recurrence::Rule::compile(const Transaction &trans) {
+    Rule rule;
+    rule.recurrence = trans.recurrence;
+    if (!trans.startDate.isValid()) {
+        RuleKinds::select<RuleKinds::Never>(rule, false);
+        return rule;
+    }
+
+    rule.startDay = trans.startDate.toJulianDay();
+    rule.startMonth = monthIndex(trans.startDate);
+    rule.dayOfMonth = trans.startDate.day();
+    rule.weekday = trans.startDate.dayOfWeek();
+    rule.week = (trans.weekOfMonth >= 1 && trans.weekOfMonth <= 4) ? trans.weekOfMonth : -1;
+    if (trans.endDate.isValid()) rule.endDay = trans.endDate.toJulianDay();
+    rule.limit = qMax(0, trans.occurrenceLimit);
+    bool bounded = trans.endDate.isValid() || rule.limit > 0;
+
+    switch (trans.recurrence) {
+    case RecurrenceType::None:
+        RuleKinds::select<RuleKinds::Once>(rule, bounded);
+        break;
+    case RecurrenceType::Weekly:
+    case RecurrenceType::BiWeekly:
+    case RecurrenceType::EveryNDays:
+        rule.interval = (trans.recurrence == RecurrenceType::Weekly) ? 7
+                      : (trans.recurrence == RecurrenceType::BiWeekly) ? 14
+                      : boundedInterval(trans.intervalDays);
+        RuleKinds::select<RuleKinds::EveryNDays>(rule, bounded);
+        break;
+    case RecurrenceType::Monthly:
+    case RecurrenceType::EveryNMonths:
+        rule.interval = intervalOf(trans);
+        RuleKinds::DayOfMonth::findClamps(rule);
+        RuleKinds::selectMonths<RuleKinds::DayOfMonth>(rule, bounded);
+        break;
+    case RecurrenceType::NthWeekday:
+        rule.interval = boundedInterval(trans.intervalMonths);
+        RuleKinds::selectMonths<RuleKinds::NthWeekday>(rule, bounded);
+        break;
+    case RecurrenceType::LastBusinessDay:
+        rule.interval = boundedInterval(trans.intervalMonths);
+        RuleKinds::selectMonths<RuleKinds::LastBusinessDay>(rule, bounded);
+        break;
+    default:
+        RuleKinds::select<RuleKinds::Never>(rule, false);
+        break;
+    }
+    return rule;
+}
+
+void Recurrence::Rule::fillSchedule(Transaction &trans) const {
+    bool valid = nthFn != &RuleKinds::Never::nth;
+    trans.startDate = valid ? QDate::fromJulianDay(startDay) : QDate();
+    trans.recurrence = recurrence;
+    trans.intervalMonths = 1;
+    trans.intervalDays = 1;
+    trans.weekOfMonth = 1;
+
+    switch (recurrence) {
+    case RecurrenceType::EveryNDays:
+        trans.intervalDays = interval;
+        break;
+    case RecurrenceType::NthWeekday:
+        trans.weekOfMonth = week;
+        trans.intervalMonths = interval;
+        break;
+    case RecurrenceType::EveryNMonths:
+    case RecurrenceType::LastBusinessDay:
+        trans.intervalMonths = interval;
+        break;
+    default:
+        break;
+    }
+
+    trans.endDate = (endDay == std::numeric_limits<qint64>::max()) ? QDate() : QDate::fromJulianDay(endDay);
+    trans.occurrenceLimit = limit;
+}
+
+int Recurrence::occurrencesUpTo(const Transaction &trans, const QDate &upToDate) {
+    if (!upToDate.isValid()) return 0;
+    return Rule::compile(trans).countUpTo(upToDate.toJulianDay());
+}
+
+QDate Recurrence::nthOccurrence(const Transaction &trans, int n) {
+    return QDate::fromJulianDay(Rule::compile(trans).nthDay(n));
+}
+
+static QString ordinal(int n) {
+    switch (n) {
+    case 1:  return "1st";
+    case 2:  return "2nd";
+    case 3:  return "3rd";
+    case -1: return "last";
+    default: return QString("%1th").arg(n);
+    }
+}
+
+QString Recurrence::describe(const Transaction &trans) {
+    QString text;
+    switch (trans.recurrence) {
+    case RecurrenceType::None:        return "";
+    case RecurrenceType::Weekly:      text = "Weekly"; break;
+    case RecurrenceType::BiWeekly:    text = "Bi-weekly"; break;
+    case RecurrenceType::Monthly:     text = "Monthly"; break;
+    case RecurrenceType::EveryNMonths:
+        text = QString("Every %1 months").arg(trans.intervalMonths);
+        break;
+    case RecurrenceType::EveryNDays:
+        text = (trans.intervalDays % 7 == 0) ? QString("Every %1 weeks").arg(trans.intervalDays / 7)
+                                             : QString("Every %1 days").arg(trans.intervalDays);
+        break;
+    case RecurrenceType::NthWeekday:
+    {
+        QString when = "the " + ordinal(trans.weekOfMonth >= 1 && trans.weekOfMonth <= 4 ? trans.weekOfMonth : -1)
+                       + " " + QLocale::c().dayName(trans.startDate.dayOfWeek());
+        text = (trans.intervalMonths > 1) ? QString("Every %1 months on %2").arg(trans.intervalMonths).arg(when)
+                                          : "Monthly on " + when;
+        break;
+    }
+    case RecurrenceType::LastBusinessDay:
+        text = (trans.intervalMonths > 1) ? QString("Last business day of every %1 months").arg(trans.intervalMonths)
+                                          : QString("Last business day of the month");
+        break;
+    }
+
+    if (trans.occurrenceLimit > 0) {
+        text += QString(", %1 times").arg(trans.occurrenceLimit);
+    }
+    if (trans.endDate.isValid()) {
+        text += ", until " + trans.endDate.toString(Qt::ISODate);
+    }
+    return text;
+}
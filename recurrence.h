@@ -0,0 +1,92 @@
+// recurrence.h
+#ifndef RECURRENCE_H
+#define RECURRENCE_H
+
+#include "transaction.h"
+
+#include <limits>
+
+namespace Recurrence {
+
+// Months since year 0, so the distance between two months is a plain subtraction
+inline int monthIndex(const QDate &date) {
+    return date.year() * 12 + date.month() - 1;
+}
+
+// Intervals (days or months) outside 1..MaxInterval count as the nearest end,
+// so no occurrence arithmetic can overflow; it is also what the binary
+// snapshot format stores
+constexpr int MaxInterval = 0xffff;
+inline int boundedInterval(int interval) {
+    return qBound(1, interval, MaxInterval);
+}
+
+// Months between two occurrences of a Monthly / EveryNMonths transaction
+inline int intervalOf(const Transaction &trans) {
+    return (trans.recurrence == RecurrenceType::Monthly) ? 1 : boundedInterval(trans.intervalMonths);
+}
+
+// Whether trans needs the general Rule evaluator: the newer kinds, any end
+// date / occurrence limit, or a Monthly / EveryNMonths start after the 28th
+// (whose day can drift, see occurrencesUpTo). Everything else has a
+// fixed-schedule column kernel in the TransactionStore.
+bool needsRule(const Transaction &trans);
+
+// A transaction's schedule compiled into an occurrence evaluator. compile()
+// picks the functions specialised for its kind (and for whether it can end)
+// once; counting or testing a day afterwards is a direct call, with no
+// switch on the kind. Days are Julian day numbers.
+class Rule {
+public:
+    static Rule compile(const Transaction &trans);
+
+    int countUpTo(qint64 day) const { return countFn(*this, day); }   // occurrences on or before day
+    bool occursOn(qint64 day) const { return onFn(*this, day); }
+    qint64 nthDay(int n) const { return nthFn(*this, n); }           // n-th occurrence, 0-based
+
+    // The schedule fields of the transaction it was compiled from
+    void fillSchedule(Transaction &trans) const;
+
+private:
+    friend struct RuleKinds;
+
+    int (*countFn)(const Rule &, qint64) = nullptr;
+    bool (*onFn)(const Rule &, qint64) = nullptr;
+    qint64 (*nthFn)(const Rule &, int) = nullptr;
+
+    RecurrenceType recurrence = RecurrenceType::None;
+    qint64 startDay = 0;
+    qint64 endDay = std::numeric_limits<qint64>::max();
+    int limit = 0;
+    int interval = 1;       // days or months, by kind
+    int startMonth = 0;     // monthIndex() of the start
+    int dayOfMonth = 1;     // of the start
+    int weekday = 1;        // of the start, 1 = Monday
+    int week = 1;           // NthWeekday
+    int skipFirst = 0;      // 1 if the start month's occurrence falls before the start
+
+    // DayOfMonth only: from month clampMonth[i] on, the day is clampDay[i]
+    // (each one shorter month that cut the day back, at most three)
+    int clamps = 0;
+    int clampMonth[3] = {};
+    int clampDay[3] = {};
+};
+
+// How many times trans has happened on or before upToDate, computed directly
+// from the day/month distance instead of stepping through every occurrence.
+// Monthly schedules fall where stepping with QDate::addMonths lands: on the
+// start day until a shorter month clamps it, then on the clamped day from
+// there on (Jan 31, Feb 28, Mar 28, ...).
+int occurrencesUpTo(const Transaction &trans, const QDate &upToDate);
+
+// Date of the n-th occurrence (0 = the first). Only meaningful for n below
+// occurrencesUpTo() of some date.
+QDate nthOccurrence(const Transaction &trans, int n);
+
+// "Weekly", "Every 3 months", "Monthly on the 2nd Tuesday, 12 times", ...
+// ("" for one-time transactions)
+QString describe(const Transaction &trans);
+
+} // namespace Recurrence
+
+#endif // RECURRENCE_H
@@ -0,0 +1,380 @@
+// statementreader.cpp
+#include "statementreader.h"
+
+#include <QDebug>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <iterator>
+
+// OFX is read this much at a time; CSV and QIF a line at a time
+static const qint64 ChunkBytes = 64 * 1024;
+
+// Header names, in order of preference
+static const char *const DescriptionNames[] = { "description", "payee", "name", "details", "narrative", "memo" };
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// The few entities OFX writers actually emit
+static QByteArray unescaped(QByteArray text) {
+    if (!text.contains('&')) return text;
+    return text.replace("&lt;", "<").replace("&gt;", ">").replace("&quot;", "\"")
+               .replace("&apos;", "'").replace("&amp;", "&");
+}
+
+StatementReader::StatementReader(const QString &path)
+    : file(path),
+    fileFormat(formatOf(path)) {
+}
+
+StatementReader::Format StatementReader::formatOf(const QString &path) {
+    QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == "ofx" || suffix == "qfx") return Ofx;
+    if (suffix == "qif") return Qif;
+    return Csv;
+}
+
+bool StatementReader::open() {
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not open statement" << file.fileName() << ":" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool StatementReader::atEnd() const {
+    return !file.isOpen() || (file.atEnd() && !pendingRecord && bufferPos >= buffer.size());
+}
+
+int StatementReader::read(QVector<Transaction> &batch, int maxRows) {
+    if (!file.isOpen() || maxRows <= 0) return 0;
+
+    switch (fileFormat) {
+    case Ofx: return readOfx(batch, maxRows);
+    case Qif: return readQif(batch, maxRows);
+    default:  return readCsv(batch, maxRows);
+    }
+}
+
+bool StatementReader::parseAmount(const QByteArray &text, Money &amount) {
+    QByteArray s = text.trimmed();
+    bool negative = false;
+    if (s.startsWith('(') && s.endsWith(')')) {
+        negative = true;
+        s = s.mid(1, s.size() - 2);
+    }
+    if (s.endsWith('-')) {
+        negative = !negative;
+        s.chop(1);
+    }
+
+    // Digits, remembering how many came before the last '.' or ','. Anything
+    // else (currency signs, spaces, apostrophes) may only surround them.
+    qint64 value = 0;
+    int digits = 0;
+    int beforeSeparator = -1;
+    bool ended = false;
+    for (int i = 0; i < s.size(); ++i) {
+        char c = s.at(i);
+        if (isDigit(c)) {
+            if (ended || digits == 16) return false;   // 16 digits still fit in cents
+            value = value * 10 + (c - '0');
+            ++digits;
+        } else if (c == '.' || c == ',') {
+            // ".50" has nothing before its point; the one in "Rs. 12" isn't a point
+            if (digits > 0 || (i + 1 < s.size() && isDigit(s.at(i + 1)))) beforeSeparator = digits;
+        } else if (c == '-' && digits == 0) {
+            negative = !negative;
+        } else if (c == ' ' || c == '\'') {
+            continue;   // "1 234", "1'234"
+        } else if (digits > 0) {
+            ended = true;
+        }
+    }
+    if (digits == 0) return false;
+
+    // A separator followed by one or two digits is the decimal point,
+    // otherwise every separator is grouping ("1,234" and "1.234" are both 1234)
+    int fraction = (beforeSeparator >= 0 && digits - beforeSeparator <= 2) ? digits - beforeSeparator : 0;
+    qint64 cents = value * (fraction == 0 ? 100 : fraction == 1 ? 10 : 1);
+    amount = Money::fromCents(negative ? -cents : cents);
+    return true;
+}
+
+QDate StatementReader::parseDate(const QByteArray &text) {
+    QByteArray s = text.trimmed();
+
+    // yyyyMMdd, possibly followed by a time (OFX)
+    if (s.size() >= 8 && std::all_of(s.begin(), s.begin() + 8, isDigit)) {
+        return QDate(s.left(4).toInt(), s.mid(4, 2).toInt(), s.mid(6, 2).toInt());
+    }
+
+    // Three numbers, split by whatever separators the exporter liked
+    int parts[3] = {};
+    int count = 0;
+    int value = -1;
+    char separator = 0;
+    for (char c : s) {
+        if (isDigit(c)) {
+            if (value > 9999) return QDate();
+            value = qMax(value, 0) * 10 + (c - '0');
+            continue;
+        }
+        if (value >= 0) {
+            parts[count++] = value;
+            value = -1;
+            if (!separator) separator = c;
+            if (count == 3) break;   // a time may follow
+        }
+    }
+    if (value >= 0 && count < 3) parts[count++] = value;
+    if (count != 3) return QDate();
+
+    int year, month, day;
+    if (parts[0] > 31) {              // yyyy-MM-dd
+        year = parts[0]; month = parts[1]; day = parts[2];
+    } else if (separator == '.') {    // d.M.yyyy
+        day = parts[0]; month = parts[1]; year = parts[2];
+    } else {                          // M/d/yyyy, M/d'yy
+        month = parts[0]; day = parts[1]; year = parts[2];
+    }
+    if (year < 100) year += (year < 70) ? 2000 : 1900;
+    return QDate(year, month, day);
+}
+
+bool StatementReader::readLine(QByteArray &line) {
+    if (file.atEnd()) return false;
+
+    bool first = file.pos() == 0;
+    line = file.readLine();
+    while (line.endsWith('\n') || line.endsWith('\r')) {
+        line.chop(1);
+    }
+    if (first && line.startsWith("\xEF\xBB\xBF")) {
+        line.remove(0, 3);   // UTF-8 byte order mark
+    }
+    return true;
+}
+
+bool StatementReader::append(const QDate &date, bool amountOk, Money amount, const QByteArray &description,
+                             QVector<Transaction> &batch) {
+    if (!date.isValid() || !amountOk) {
+        ++rejected;
+        return false;
+    }
+
+    Transaction trans;
+    trans.startDate = date;
+    trans.amount = amount;
+    trans.description = QString::fromUtf8(description.trimmed());
+    batch.append(trans);
+    return true;
+}
+
+bool StatementReader::appendRecord(QVector<Transaction> &batch) {
+    Money amount;
+    bool amountOk = parseAmount(record.amount, amount);
+    const QByteArray &description = record.payee.isEmpty() ? record.memo : record.payee;
+    bool added = append(parseDate(record.date), amountOk, amount, unescaped(description), batch);
+    record = Record();
+    return added;
+}
+
+// ---- CSV --------------------------------------------------------------------
+
+// Splits one record into fields; a quoted field may span lines
+bool StatementReader::readCsvRecord() {
+    QByteArray line;
+    if (!readLine(line)) return false;
+
+    fields.clear();
+    QByteArray field;
+    bool quoted = false;
+    for (;;) {
+        for (int i = 0; i < line.size(); ++i) {
+            char c = line.at(i);
+            if (quoted) {
+                if (c != '"') {
+                    field += c;
+                } else if (i + 1 < line.size() && line.at(i + 1) == '"') {
+                    field += '"';
+                    ++i;
+                } else {
+                    quoted = false;
+                }
+            } else if (c == '"') {
+                quoted = true;
+            } else if (c == delimiter) {
+                fields.append(field);
+                field.clear();
+            } else {
+                field += c;
+            }
+        }
+        if (!quoted || !readLine(line)) break;
+        field += '\n';
+    }
+    fields.append(field);
+    return true;
+}
+
+void StatementReader::readCsvHeader() {
+    headerRead = true;
+
+    // Exports using decimal commas separate fields with ';'
+    QByteArray first = file.peek(4096);
+    int end = first.indexOf('\n');
+    if (end >= 0) first.truncate(end);
+    delimiter = first.count(';') > first.count(',') ? ';' : ',';
+
+    if (!readCsvRecord()) return;
+
+    int date = -1, amount = -1, debit = -1, credit = -1, description = -1;
+    int preference = int(std::size(DescriptionNames));
+    for (int i = 0; i < fields.size(); ++i) {
+        QByteArray name = fields.at(i).trimmed().toLower();
+        if (name.contains("date")) {
+            if (date < 0) date = i;
+        } else if (name == "amount") {
+            amount = i;
+        } else if (name == "debit" || name == "withdrawal" || name == "withdrawals") {
+            debit = i;
+        } else if (name == "credit" || name == "deposit" || name == "deposits") {
+            credit = i;
+        } else {
+            for (int p = 0; p < preference; ++p) {
+                if (name == DescriptionNames[p]) {
+                    description = i;
+                    preference = p;
+                    break;
+                }
+            }
+        }
+    }
+
+    // No recognisable header: the first line is already data
+    if (date < 0 || (amount < 0 && debit < 0 && credit < 0)) {
+        pendingRecord = true;
+        return;
+    }
+    dateColumn = date;
+    amountColumn = amount;
+    debitColumn = debit;
+    creditColumn = credit;
+    descriptionColumn = description;
+}
+
+int StatementReader::readCsv(QVector<Transaction> &batch, int maxRows) {
+    if (!headerRead) readCsvHeader();
+
+    auto field = [&](int column) {
+        return (column >= 0 && column < fields.size()) ? fields.at(column) : QByteArray();
+    };
+
+    int added = 0;
+    while (added < maxRows) {
+        if (!pendingRecord && !readCsvRecord()) break;
+        pendingRecord = false;
+        if (fields.size() == 1 && fields.at(0).trimmed().isEmpty()) continue;   // blank line
+
+        Money amount;
+        bool amountOk;
+        if (amountColumn >= 0) {
+            amountOk = parseAmount(field(amountColumn), amount);
+        } else {
+            // Separate columns; debits may be written with or without a sign
+            Money debit, credit;
+            bool hasDebit = parseAmount(field(debitColumn), debit);
+            bool hasCredit = parseAmount(field(creditColumn), credit);
+            amountOk = hasDebit || hasCredit;
+            amount = credit - (debit.isNegative() ? -debit : debit);
+        }
+
+        if (append(parseDate(field(dateColumn)), amountOk, amount, field(descriptionColumn), batch)) {
+            ++added;
+        }
+    }
+    return added;
+}
+
+// ---- OFX --------------------------------------------------------------------
+
+int StatementReader::readOfx(QVector<Transaction> &batch, int maxRows) {
+    int added = 0;
+    while (added < maxRows) {
+        // One tag runs from its '<' to the next one: SGML values have no closing tag
+        int start = buffer.indexOf('<', bufferPos);
+        int next = (start < 0) ? -1 : buffer.indexOf('<', start + 1);
+        if (next < 0 && !file.atEnd()) {
+            buffer = buffer.mid(start < 0 ? buffer.size() : start) + file.read(ChunkBytes);
+            bufferPos = 0;
+            continue;
+        }
+        if (start < 0) {
+            buffer.clear();
+            bufferPos = 0;
+            break;
+        }
+        if (next < 0) next = int(buffer.size());
+        bufferPos = next;
+
+        int close = buffer.indexOf('>', start);
+        if (close < 0 || close > next) continue;
+        QByteArray tag = buffer.mid(start + 1, close - start - 1).trimmed().toUpper();
+        QByteArray value = buffer.mid(close + 1, next - close - 1).trimmed();
+
+        if (tag == "STMTTRN") {
+            record = Record();
+            record.started = true;
+        } else if (!record.started) {
+            continue;
+        } else if (tag == "/STMTTRN") {
+            if (appendRecord(batch)) ++added;
+        } else if (tag == "DTPOSTED") {
+            record.date = value;
+        } else if (tag == "TRNAMT") {
+            record.amount = value;
+        } else if (tag == "NAME") {
+            record.payee = value;
+        } else if (tag == "MEMO") {
+            record.memo = value;
+        }
+    }
+    return added;
+}
+
+// ---- QIF --------------------------------------------------------------------
+
+int StatementReader::readQif(QVector<Transaction> &batch, int maxRows) {
+    int added = 0;
+    QByteArray line;
+    while (added < maxRows) {
+        if (!readLine(line)) {
+            // The last record may lack its closing ^
+            if (record.started && appendRecord(batch)) ++added;
+            break;
+        }
+        if (line.isEmpty()) continue;
+
+        QByteArray value = line.mid(1).trimmed();
+        switch (line.at(0)) {
+        case 'D': record.date = value; break;
+        case 'T':
+        case 'U': record.amount = value; break;
+        case 'P': record.payee = value; break;
+        case 'M': record.memo = value; break;
+        case '^':
+            if (appendRecord(batch)) ++added;
+            continue;
+        case '!':
+            record = Record();   // !Type: header
+            continue;
+        default:
+            continue;            // categories, splits, cleared status...
+        }
+        record.started = true;
+    }
+    return added;
+}
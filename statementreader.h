@@ -0,0 +1,76 @@
+// statementreader.h
+#ifndef STATEMENTREADER_H
+#define STATEMENTREADER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include "transaction.h"
+
+// Reads one-time transactions from a bank statement export, a bounded batch
+// at a time, so files of any size go through a small buffer:
+//   - CSV: a header naming the date / amount (or debit + credit) /
+//     description columns, or no header and date,amount,description
+//   - OFX / QFX: the <STMTTRN> records, SGML or XML flavour
+//   - QIF: D / T / P / M fields, one record per ^
+// Dates may be yyyy-MM-dd, yyyyMMdd, M/d/yyyy (QIF also M/d'yy) or d.M.yyyy.
+// Rows without a readable date or amount are counted and skipped.
+class StatementReader {
+public:
+    enum Format { Csv, Ofx, Qif };
+
+    explicit StatementReader(const QString &path);
+
+    static Format formatOf(const QString &path);   // by extension, CSV if unknown
+    Format format() const { return fileFormat; }
+
+    bool open();
+    bool atEnd() const;
+
+    // Appends up to maxRows transactions to batch; returns how many
+    int read(QVector<Transaction> &batch, int maxRows);
+
+    qint64 bytesRead() const { return file.pos(); }
+    qint64 bytesTotal() const { return file.size(); }
+    int rejectedRows() const { return rejected; }
+
+    // Exact parse to cents: "-1,234.5", "(12.00)", "$3", "4.20-"
+    static bool parseAmount(const QByteArray &text, Money &amount);
+    static QDate parseDate(const QByteArray &text);
+
+private:
+    // OFX / QIF fields of the record being read
+    struct Record {
+        QByteArray date, amount, payee, memo;
+        bool started = false;
+    };
+
+    bool readLine(QByteArray &line);
+    bool readCsvRecord();
+    void readCsvHeader();
+    int readCsv(QVector<Transaction> &batch, int maxRows);
+    int readOfx(QVector<Transaction> &batch, int maxRows);
+    int readQif(QVector<Transaction> &batch, int maxRows);
+    bool append(const QDate &date, bool amountOk, Money amount, const QByteArray &description,
+                QVector<Transaction> &batch);
+    bool appendRecord(QVector<Transaction> &batch);
+
+    QFile file;
+    Format fileFormat;
+    int rejected = 0;
+
+    // CSV: the current record's fields and which column holds what (-1: none)
+    QVector<QByteArray> fields;
+    char delimiter = ',';
+    bool headerRead = false;
+    bool pendingRecord = false;    // fields hold a data row read with the header
+    int dateColumn = 0, amountColumn = 1, debitColumn = -1, creditColumn = -1, descriptionColumn = 2;
+
+    QByteArray buffer;             // OFX: text not yet split into tags, from bufferPos on
+    int bufferPos = 0;
+    Record record;
+};
+
+#endif // STATEMENTREADER_H
@@ -0,0 +1,35 @@
+// transaction.h
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include <QDate>
+#include <QString>
+
+#include "money.h"
+
+// Values are stored in files; only ever append
+enum class RecurrenceType {
+    None,
+    Weekly,
+    BiWeekly,
+    Monthly,          // = every 1 month
+    EveryNMonths,     // 2,3,4,... months
+    EveryNDays,       // intervalDays apart (a multiple of 7 for every N weeks)
+    NthWeekday,       // startDate's weekday, weekOfMonth-th in the month, every intervalMonths
+    LastBusinessDay   // last Monday-Friday of the month, every intervalMonths
+};
+
+struct Transaction {
+    QDate startDate;
+    QString description;
+    Money amount;
+    RecurrenceType recurrence = RecurrenceType::None;
+    int intervalMonths = 1;   // EveryNMonths, NthWeekday, LastBusinessDay
+    int intervalDays = 1;     // EveryNDays
+    int weekOfMonth = 1;      // NthWeekday: 1-4, or -1 for the last one in the month
+    QDate endDate;            // last day it may happen on; invalid = no end
+    int occurrenceLimit = 0;  // happens at most this many times; 0 = no limit
+    int id = -1;
+};
+
+#endif // TRANSACTION_H
@@ -0,0 +1,259 @@
+// transactionstore.cpp
+#include "transactionstore.h"
+#include "balancekernels.h"
+#include "recurrence.h"
+
+#include <QDebug>
+
+TransactionStore::Group TransactionStore::groupOf(const Transaction &trans) {
+    if (Recurrence::needsRule(trans)) return Rules;
+
+    switch (trans.recurrence) {
+    case RecurrenceType::None:         return OneTime;
+    case RecurrenceType::Weekly:       return Weekly;
+    case RecurrenceType::BiWeekly:     return BiWeekly;
+    case RecurrenceType::Monthly:
+    case RecurrenceType::EveryNMonths: return Monthly;
+    default:                           return Rules;
+    }
+}
+
+qint64 TransactionStore::memoryUsage() const {
+    qint64 bytes = 0;
+    for (const QVector<Columns> &chunks : groups) {
+        for (const Columns &c : chunks) {
+            bytes += (c.startDay.capacity() + c.startMonth.capacity() + c.startDom.capacity()
+                      + c.interval.capacity() + c.ids.capacity()) * qint64(sizeof(qint32))
+                     + c.amount.capacity() * qint64(sizeof(qint64))
+                     + c.rules.capacity() * qint64(sizeof(Recurrence::Rule));
+        }
+    }
+    for (const QVector<EntryChunk> *table : { &entries, &negativeEntries }) {
+        for (const EntryChunk &chunk : *table) {
+            bytes += chunk.capacity() * qint64(sizeof(Entry));
+            for (const Entry &entry : chunk) {
+                bytes += entry.description.size() * qint64(sizeof(QChar));
+            }
+        }
+    }
+    return bytes;
+}
+
+int TransactionStore::rowCount(Group group) const {
+    const QVector<Columns> &chunks = groups[group];
+    if (chunks.isEmpty()) return 0;
+    return (int(chunks.size()) - 1) * ChunkRows + chunks.last().size();
+}
+
+void TransactionStore::clear() {
+    for (auto &chunks : groups) {
+        chunks.clear();
+    }
+    entries.clear();
+    negativeEntries.clear();
+    count = 0;
+    maxAbsCents = 0;
+    firstDay = NeverDay;
+}
+
+void TransactionStore::assign(const QVector<Transaction> &transactions) {
+    clear();
+    for (const auto &trans : transactions) {
+        add(trans);
+    }
+}
+
+const TransactionStore::Entry *TransactionStore::entryOf(int id) const {
+    const QVector<EntryChunk> &table = (id >= 0) ? entries : negativeEntries;
+    int slot = slotOf(id);
+    if (id == -1 || slot / ChunkRows >= table.size()) return nullptr;
+
+    const EntryChunk &chunk = table.at(slot / ChunkRows);
+    if (chunk.isEmpty()) return nullptr;
+
+    const Entry &entry = chunk.at(slot % ChunkRows);
+    return entry.group < 0 ? nullptr : &entry;
+}
+
+TransactionStore::Entry &TransactionStore::entryFor(int id) {
+    QVector<EntryChunk> &table = (id >= 0) ? entries : negativeEntries;
+    int slot = slotOf(id);
+    int index = slot / ChunkRows;
+    if (index >= table.size()) {
+        table.resize(index + 1);
+    }
+
+    EntryChunk &chunk = table[index];
+    if (chunk.isEmpty()) {
+        chunk.resize(ChunkRows);
+    }
+    return chunk[slot % ChunkRows];
+}
+
+bool TransactionStore::add(const Transaction &trans) {
+    if (trans.id == -1 || contains(trans.id)) {
+        qWarning() << "Could not add transaction with id" << trans.id;
+        return false;
+    }
+
+    Group group = groupOf(trans);
+    QVector<Columns> &chunks = groups[group];
+    if (chunks.isEmpty() || chunks.last().size() == ChunkRows) {
+        chunks.append(Columns());
+    }
+    Columns &columns = chunks.last();
+    bool valid = trans.startDate.isValid();
+
+    qint32 startDay = valid ? qint32(trans.startDate.toJulianDay()) : NeverDay;
+    qint64 cents = trans.amount.cents();
+    columns.startDay.append(startDay);
+    columns.amount.append(cents);
+    if (group == Monthly) {
+        columns.startMonth.append(valid ? Recurrence::monthIndex(trans.startDate) : NeverDay);
+        columns.startDom.append(valid ? trans.startDate.day() : 1);
+        columns.interval.append(Recurrence::intervalOf(trans));
+    } else if (group == Rules) {
+        columns.rules.append(Recurrence::Rule::compile(trans));
+    }
+    columns.ids.append(trans.id);
+
+    // qAbs(INT64_MIN) would overflow
+    qint64 magnitude = (cents == std::numeric_limits<qint64>::min()) ? std::numeric_limits<qint64>::max() : qAbs(cents);
+    maxAbsCents = qMax(maxAbsCents, magnitude);
+    firstDay = qMin(firstDay, startDay);
+
+    Entry &entry = entryFor(trans.id);
+    entry.group = group;
+    entry.row = rowCount(group) - 1;
+    entry.recurrence = trans.recurrence;
+    entry.description = trans.description;
+    ++count;
+    return true;
+}
+
+bool TransactionStore::remove(int id) {
+    const Entry *found = entryOf(id);
+    if (!found) return false;
+
+    Group group = Group(found->group);
+    int row = found->row;
+    int last = rowCount(group) - 1;
+    QVector<Columns> &chunks = groups[group];
+
+    // Swap-and-pop: the last row fills the gap, so only two chunks change
+    if (row != last) {
+        Columns &to = chunks[row / ChunkRows];
+        const Columns &from = chunks.at(last / ChunkRows);
+        int t = row % ChunkRows;
+        int f = last % ChunkRows;
+
+        to.startDay[t] = from.startDay.at(f);
+        to.amount[t] = from.amount.at(f);
+        if (group == Monthly) {
+            to.startMonth[t] = from.startMonth.at(f);
+            to.startDom[t] = from.startDom.at(f);
+            to.interval[t] = from.interval.at(f);
+        } else if (group == Rules) {
+            to.rules[t] = from.rules.at(f);
+        }
+        to.ids[t] = from.ids.at(f);
+        entryFor(to.ids.at(t)).row = row;
+    }
+
+    Columns &tail = chunks.last();
+    tail.startDay.removeLast();
+    tail.amount.removeLast();
+    if (group == Monthly) {
+        tail.startMonth.removeLast();
+        tail.startDom.removeLast();
+        tail.interval.removeLast();
+    } else if (group == Rules) {
+        tail.rules.removeLast();
+    }
+    tail.ids.removeLast();
+    if (tail.size() == 0) {
+        chunks.removeLast();
+    }
+
+    entryFor(id) = Entry();
+    --count;
+    return true;
+}
+
+Transaction TransactionStore::scheduleAt(Group group, int row) const {
+    const Columns &columns = groups[group].at(row / ChunkRows);
+    int i = row % ChunkRows;
+
+    Transaction trans;
+    qint32 startDay = columns.startDay.at(i);
+    trans.startDate = (startDay == NeverDay) ? QDate() : QDate::fromJulianDay(startDay);
+    trans.amount = Money::fromCents(columns.amount.at(i));
+    trans.id = columns.ids.at(i);
+
+    switch (group) {
+    case OneTime:  trans.recurrence = RecurrenceType::None; break;
+    case Weekly:   trans.recurrence = RecurrenceType::Weekly; break;
+    case BiWeekly: trans.recurrence = RecurrenceType::BiWeekly; break;
+    case Rules:    columns.rules.at(i).fillSchedule(trans); break;
+    default:
+        trans.intervalMonths = columns.interval.at(i);
+        trans.recurrence = (trans.intervalMonths == 1) ? RecurrenceType::Monthly : RecurrenceType::EveryNMonths;
+        break;
+    }
+    return trans;
+}
+
+Transaction TransactionStore::transaction(int id) const {
+    const Entry *entry = entryOf(id);
+    if (!entry) return Transaction();
+
+    Transaction trans = scheduleAt(Group(entry->group), entry->row);
+    trans.recurrence = entry->recurrence;
+    trans.description = entry->description;
+    return trans;
+}
+
+QVector<Transaction> TransactionStore::toVector() const {
+    QVector<Transaction> result;
+    result.reserve(count);
+
+    auto append = [&](const Entry &entry) {
+        if (entry.group < 0) return;
+        Transaction trans = scheduleAt(Group(entry.group), entry.row);
+        trans.recurrence = entry.recurrence;
+        trans.description = entry.description;
+        result.append(trans);
+    };
+
+    // The side tables are indexed by id, so walking them is already in id
+    // order; the negative one backwards
+    for (auto chunk = negativeEntries.crbegin(); chunk != negativeEntries.crend(); ++chunk) {
+        for (auto entry = chunk->crbegin(); entry != chunk->crend(); ++entry) {
+            append(*entry);
+        }
+    }
+    for (const EntryChunk &chunk : entries) {
+        for (const Entry &entry : chunk) {
+            append(entry);
+        }
+    }
+    return result;
+}
+
+Money TransactionStore::balanceUpTo(const QDate &date) const {
+    if (!date.isValid()) return Money();
+
+    BalanceKernels::Target target = BalanceKernels::Target::fromDate(date);
+    Money balance, net;
+    BalanceKernels::project(*this, &target, 1, &balance, &net);
+    return balance;
+}
+
+Money TransactionStore::netOn(const QDate &date) const {
+    if (!date.isValid()) return Money();
+
+    BalanceKernels::Target target = BalanceKernels::Target::fromDate(date);
+    Money net;
+    BalanceKernels::projectNets(*this, &target, 1, &net);
+    return net;
+}
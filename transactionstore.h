@@ -0,0 +1,108 @@
+// transactionstore.h
+#ifndef TRANSACTIONSTORE_H
+#define TRANSACTIONSTORE_H
+
+#include <QVector>
+#include <QDate>
+
+#include "recurrence.h"
+#include "transaction.h"
+
+#include <limits>
+
+// The ledger, stored column-wise. The fields the balance loops read live in
+// contiguous arrays per recurrence group, so each loop streams through plain
+// numbers with no per-row branching (see balancekernels.h); descriptions and
+// other cold data sit in a side table indexed by id.
+//
+// Both are cut into chunks of ChunkRows implicitly shared arrays. Copying a
+// store is therefore cheap, and editing the copy afterwards only duplicates
+// the chunks it touches, which is what lets Ledger hand immutable versions
+// to other threads while it keeps editing its own.
+class TransactionStore {
+public:
+    // Monthly includes EveryNMonths. Rules holds whatever needs
+    // Recurrence::Rule (see Recurrence::needsRule), evaluated row by row.
+    enum Group { OneTime, Weekly, BiWeekly, Monthly, Rules, GroupCount };
+
+    // Hot columns of one chunk of a group, one row per transaction
+    struct Columns {
+        QVector<qint32> startDay;     // Julian day, NeverDay if the date is invalid
+        QVector<qint64> amount;       // cents
+        QVector<qint32> startMonth;   // Monthly group only: Recurrence::monthIndex
+        QVector<qint32> startDom;     // Monthly group only: day of month, 1-28 (see Recurrence::needsRule)
+        QVector<qint32> interval;     // Monthly group only: months between occurrences
+        QVector<Recurrence::Rule> rules;   // Rules group only
+        QVector<int> ids;
+
+        int size() const { return int(ids.size()); }
+    };
+
+    static constexpr int ChunkRows = 4096;
+    static constexpr qint32 NeverDay = std::numeric_limits<qint32>::max();
+
+    static Group groupOf(const Transaction &trans);
+
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+    bool contains(int id) const { return entryOf(id) != nullptr; }
+
+    // A group's rows; every chunk but the last holds exactly ChunkRows
+    const QVector<Columns> &chunks(Group group) const { return groups[group]; }
+    int rowCount(Group group) const;
+    qint64 memoryUsage() const;   // bytes held by columns, entries and descriptions, roughly
+
+    // Bounds the kernels use to tell whether a sum could overflow 64 bits.
+    // They only ever widen (a removal doesn't shrink them) until clear().
+    qint64 largestAmount() const { return maxAbsCents; }   // |amount| in cents
+    qint32 earliestStartDay() const { return firstDay; }   // NeverDay if none
+
+    void clear();
+    void assign(const QVector<Transaction> &transactions);
+    // trans.id must be unused, and not -1 (no id). Ids below -1 are for rows
+    // that aren't the user's, such as Ledger's archive checkpoints.
+    bool add(const Transaction &trans);
+    bool remove(int id);                  // the group's last row moves into the gap
+
+    Transaction transaction(int id) const;
+    QVector<Transaction> toVector() const;   // ordered by id
+
+    // Visits every transaction's schedule (everything but the description)
+    template <typename Visitor> void forEachSchedule(Visitor visit) const;
+
+    Money balanceUpTo(const QDate &date) const;
+    Money netOn(const QDate &date) const;
+
+private:
+    struct Entry {
+        int group = -1;               // -1: no transaction with this id
+        int row = 0;
+        RecurrenceType recurrence = RecurrenceType::None;
+        QString description;
+    };
+    typedef QVector<Entry> EntryChunk;   // ids [n * ChunkRows, (n + 1) * ChunkRows)
+    static int slotOf(int id) { return id >= 0 ? id : -(id + 2); }   // -2, -3, ... count up from 0
+
+    const Entry *entryOf(int id) const;
+    Entry &entryFor(int id);             // allocates the chunk if needed
+    Transaction scheduleAt(Group group, int row) const;
+
+    QVector<Columns> groups[GroupCount];
+    QVector<EntryChunk> entries;
+    QVector<EntryChunk> negativeEntries;   // ids below -1, by slotOf
+    int count = 0;
+    qint64 maxAbsCents = 0;
+    qint32 firstDay = NeverDay;
+};
+
+template <typename Visitor>
+void TransactionStore::forEachSchedule(Visitor visit) const {
+    for (int group = 0; group < GroupCount; ++group) {
+        int rows = rowCount(Group(group));
+        for (int row = 0; row < rows; ++row) {
+            visit(scheduleAt(Group(group), row));
+        }
+    }
+}
+
+#endif // TRANSACTIONSTORE_H
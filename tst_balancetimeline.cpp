@@ -0,0 +1,123 @@
+// tst_balancetimeline.cpp
+// Single adds and deletes applied to a cached timeline as deltas, against a
+// full recompute after every edit, day by day. The verifier (--verify) checks
+// the same against its reference on a few dates; this covers every day.
+#include "balancetimeline.h"
+#include "ledger.h"
+#include "ledgerverifier.h"
+#include "tst_support.h"
+
+#include <QTemporaryDir>
+
+#include <random>
+
+// Where the first difference is, if any
+static QString compareDays(const BalanceTimeline &applied, const BalanceTimeline &rebuilt) {
+    if (applied.firstDate() != rebuilt.firstDate() || applied.lastDate() != rebuilt.lastDate()) {
+        return "ranges differ";
+    }
+    for (QDate date = rebuilt.firstDate(); date <= rebuilt.lastDate(); date = date.addDays(1)) {
+        if (applied.balanceOn(date) != rebuilt.balanceOn(date) || applied.netOn(date) != rebuilt.netOn(date)) {
+            return QString("%1: balance %2 / net %3, recomputed %4 / %5").arg(date.toString(Qt::ISODate),
+                applied.balanceOn(date).toString(), applied.netOn(date).toString(),
+                rebuilt.balanceOn(date).toString(), rebuilt.netOn(date).toString());
+        }
+    }
+    return QString();
+}
+
+class BalanceTimelineTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void deltasMatchRebuild_data();
+    void deltasMatchRebuild();
+    void ledgerEditsMatchForecast();
+};
+
+void BalanceTimelineTest::deltasMatchRebuild_data() {
+    QTest::addColumn<quint32>("seed");
+    for (quint32 seed = 1; seed <= 8; ++seed) {
+        QTest::newRow(qPrintable(QString("seed %1").arg(seed))) << seed;
+    }
+}
+
+void BalanceTimelineTest::deltasMatchRebuild() {
+    QFETCH(quint32, seed);
+    std::mt19937 random(seed);
+
+    // The verifier's awkward rows, and a range that may start before, among
+    // or after their first occurrences
+    const QDate around(2020, 6, 15);
+    QVector<Transaction> rows = LedgerVerifier::randomLedger(seed, 40, around);
+    TransactionStore store;
+    store.assign(rows);
+    QDate from = around.addDays(qint64(random() % 1500) - 900);
+    QDate to = from.addDays(qint64(random() % 800));
+
+    BalanceTimeline applied;
+    QVERIFY(applied.rebuild(store, from, to));
+
+    int nextId = int(rows.size());
+    for (int edit = 0; edit < 60; ++edit) {
+        if (random() % 2 == 0 && !rows.isEmpty()) {
+            int i = int(random() % rows.size());
+            applied.apply(rows[i], -1);
+            QVERIFY(store.remove(rows[i].id));
+            rows.removeAt(i);
+        } else {
+            Transaction trans = LedgerVerifier::randomLedger(seed * 1000 + edit, 1, around).first();
+            trans.id = nextId++;
+            QVERIFY(store.add(trans));
+            applied.apply(trans, 1);
+            rows.append(trans);
+        }
+
+        BalanceTimeline rebuilt;
+        QVERIFY(rebuilt.rebuild(store, from, to));
+        QString difference = compareDays(applied, rebuilt);
+        QVERIFY2(difference.isEmpty(), qPrintable(QString("after edit %1, %2").arg(edit).arg(difference)));
+    }
+}
+
+// The same through Ledger::add / remove, whose cached range the main window
+// paints from
+void BalanceTimelineTest::ledgerEditsMatchForecast() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+    Ledger ledger(directory.path());
+    QVERIFY(ledger.load());
+
+    const QDate around(2025, 1, 15);
+    const QDate from = around.addMonths(-2);
+    const QDate to = around.addMonths(3).addDays(-1);
+    QVector<int> ids;
+    for (const Transaction &trans : LedgerVerifier::randomLedger(7, 30, around)) {
+        ids.append(ledger.add(trans));
+    }
+    ledger.cacheRange(from, to);
+
+    std::mt19937 random(7);
+    for (int edit = 0; edit < 40; ++edit) {
+        if (random() % 2 == 0 && !ids.isEmpty()) {
+            int i = int(random() % ids.size());
+            QCOMPARE(ledger.remove({ ids[i] }), 1);
+            ids.removeAt(i);
+        } else {
+            ids.append(ledger.add(LedgerVerifier::randomLedger(100 + edit, 1, around).first()));
+        }
+        QVERIFY(ledger.isCached(from, to));
+
+        BalanceTimeline rebuilt = ledger.forecast(from, to);
+        for (QDate date = from; date <= to; date = date.addDays(1)) {
+            QCOMPARE(ledger.balanceOn(date), rebuilt.balanceOn(date));
+            QCOMPARE(ledger.netOn(date), rebuilt.netOn(date));
+        }
+    }
+}
+
+QObject *createBalanceTimelineTest() {
+    return new BalanceTimelineTest;
+}
+
+#include "tst_balancetimeline.moc"
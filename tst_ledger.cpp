@@ -0,0 +1,190 @@
+// tst_ledger.cpp
+// Ledger edits keyed by id: archive checkpoints never share one with a
+// transaction, archived rows still count as already imported, and deleting
+// removes just the selected row however alike the others are.
+#include "ledger.h"
+#include "tst_support.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+
+static Transaction oneTime(const QDate &date, qint64 cents, const QString &description) {
+    Transaction trans;
+    trans.startDate = date;
+    trans.amount = Money::fromCents(cents);
+    trans.description = description;
+    return trans;
+}
+
+// Two rows in each of 2020 and 2021, archived, plus one left in the ledger
+static void fillAndArchive(Ledger &ledger) {
+    ledger.add(oneTime(QDate(2020, 3, 1), 1000, "coffee"));
+    ledger.add(oneTime(QDate(2020, 3, 1), 1000, "coffee"));
+    ledger.add(oneTime(QDate(2021, 6, 15), -2500, "books"));
+    ledger.add(oneTime(QDate(2021, 12, 31), 400, "refund"));
+    ledger.add(oneTime(QDate(2024, 1, 2), 700, "current"));
+    ledger.archive(QDate(2022, 1, 1));
+}
+
+class LedgerTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void negativeIdsInStore();
+    void checkpointIdsNeverCollide();
+    void importSkipsArchivedRows();
+    void removeDeletesOnlyThatId();
+};
+
+void LedgerTest::negativeIdsInStore() {
+    TransactionStore store;
+    QVERIFY(!store.add(oneTime(QDate(2024, 1, 1), 1, "reserved")));   // -1 means "no id"
+    Transaction first = oneTime(QDate(2024, 1, 1), 100, "first");
+    first.id = 0;
+    QVERIFY(store.add(first));
+    Transaction checkpoint = oneTime(QDate(2024, 12, 31), 200, "checkpoint");
+    checkpoint.id = -2;
+    QVERIFY(store.add(checkpoint));
+    checkpoint.id = -2 - TransactionStore::ChunkRows;   // a second chunk of them
+    QVERIFY(store.add(checkpoint));
+    QVERIFY(!store.add(checkpoint));
+
+    QVERIFY(store.contains(0));
+    QVERIFY(store.contains(-2));
+    QVERIFY(!store.contains(-3));
+    QCOMPARE(store.transaction(-2).amount, Money::fromCents(200));
+    QCOMPARE(store.balanceUpTo(QDate(2025, 1, 1)), Money::fromCents(500));
+
+    QVector<Transaction> rows = store.toVector();
+    QCOMPARE(rows.size(), 3);
+    QCOMPARE(rows[0].id, -2 - TransactionStore::ChunkRows);   // ordered by id
+    QCOMPARE(rows[1].id, -2);
+    QCOMPARE(rows[2].id, 0);
+
+    QVERIFY(store.remove(-2));
+    QVERIFY(!store.contains(-2));
+    QCOMPARE(store.size(), 2);
+}
+
+void LedgerTest::checkpointIdsNeverCollide() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    Ledger ledger(directory.path());
+    QVERIFY(ledger.load());
+    fillAndArchive(ledger);
+    QCOMPARE(ledger.archivedBefore(), 2022);
+
+    // New rows get the ids the archived ones had no claim on any more
+    for (int i = 0; i < 8; ++i) {
+        QVERIFY(ledger.add(oneTime(QDate(2024, 2, 1 + i), 10, "later")) >= 0);
+    }
+
+    LedgerSnapshot version = ledger.snapshot();
+    QVector<Transaction> checkpoints = version->archived.toVector();
+    QCOMPARE(checkpoints.size(), 2);
+    for (const Transaction &checkpoint : checkpoints) {
+        QVERIFY(checkpoint.id < -1);
+        QVERIFY(!version->store.contains(checkpoint.id));
+    }
+    QCOMPARE(ledger.balanceOn(QDate(2021, 12, 31)), Money::fromCents(-100));
+    QCOMPARE(ledger.balanceOn(QDate(2024, 12, 31)), Money::fromCents(680));
+
+    // And so does every load after it
+    Ledger reloaded(directory.path());
+    QVERIFY(reloaded.load());
+    QCOMPARE(reloaded.balanceOn(QDate(2024, 12, 31)), Money::fromCents(680));
+    QVERIFY(reloaded.add(oneTime(QDate(2024, 3, 1), 20, "after reload")) >= 0);
+    QCOMPARE(reloaded.snapshot()->archived.size(), 2);
+    QCOMPARE(reloaded.balanceOn(QDate(2024, 12, 31)), Money::fromCents(700));
+}
+
+void LedgerTest::importSkipsArchivedRows() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    Ledger ledger(directory.path());
+    QVERIFY(ledger.load());
+    fillAndArchive(ledger);
+
+    // The archived rows again, one of the two coffees once more, and one new row
+    QString statement = directory.filePath("statement.csv");
+    {
+        QFile file(statement);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QTextStream out(&file);
+        out << "Date,Description,Amount\n"
+            << "2020-03-01,coffee,10.00\n"
+            << "2020-03-01,coffee,10.00\n"
+            << "2020-03-01,coffee,10.00\n"
+            << "2021-06-15,books,-25.00\n"
+            << "2021-12-31,refund,4.00\n"
+            << "2021-12-30,new,1.00\n";
+    }
+
+    Ledger::ImportResult result = ledger.import(statement);
+    QVERIFY(result.ok);
+    QCOMPARE(result.duplicates, 4);
+    QCOMPARE(result.added, 2);   // the third coffee and the new row
+    QCOMPARE(ledger.balanceOn(QDate(2024, 12, 31)), Money::fromCents(1700));
+
+    // Importing it once more adds nothing
+    result = ledger.import(statement);
+    QVERIFY(result.ok);
+    QCOMPARE(result.added, 0);
+    QCOMPARE(result.duplicates, 6);
+}
+
+// Rows nothing but the id tells apart, as a statement with two equal coffees
+// on a day gives: deleting the selected one must leave its twin
+void LedgerTest::removeDeletesOnlyThatId() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    Ledger ledger(directory.path());
+    QVERIFY(ledger.load());
+    const QDate day(2025, 3, 3);
+    Transaction weekly = oneTime(day, -450, "coffee");
+    weekly.recurrence = RecurrenceType::Weekly;
+
+    int first = ledger.add(oneTime(day, -450, "coffee"));
+    int second = ledger.add(oneTime(day, -450, "coffee"));
+    int third = ledger.add(oneTime(day, -500, "coffee"));
+    int firstWeekly = ledger.add(weekly);
+    int secondWeekly = ledger.add(weekly);
+    QCOMPARE(ledger.transactionsOn(day), QVector<int>({ first, second, third, firstWeekly, secondWeekly }));
+    QCOMPARE(ledger.netOn(day), Money::fromCents(-2300));
+
+    QCOMPARE(ledger.remove({ second, firstWeekly }), 2);
+    QCOMPARE(ledger.remove({ second }), 0);   // already gone
+    QVERIFY(ledger.transactions().contains(first));
+    QVERIFY(!ledger.transactions().contains(second));
+    QVERIFY(ledger.transactions().contains(third));
+    QVERIFY(!ledger.transactions().contains(firstWeekly));
+    QVERIFY(ledger.transactions().contains(secondWeekly));
+
+    QVector<int> left = ledger.transactionsOn(day);
+    std::sort(left.begin(), left.end());
+    QCOMPARE(left, QVector<int>({ first, third, secondWeekly }));
+    QCOMPARE(ledger.transactionsOn(day.addDays(7)), QVector<int>({ secondWeekly }));
+    QCOMPARE(ledger.netOn(day), Money::fromCents(-1400));
+    QCOMPARE(ledger.balanceOn(day.addDays(7)), Money::fromCents(-1850));
+
+    // The journal deletes by id too
+    Ledger reloaded(directory.path());
+    QVERIFY(reloaded.load());
+    QCOMPARE(reloaded.transactions().size(), 3);
+    QVERIFY(reloaded.transactions().contains(first));
+    QVERIFY(reloaded.transactions().contains(third));
+    QVERIFY(reloaded.transactions().contains(secondWeekly));
+    QCOMPARE(reloaded.balanceOn(day.addDays(7)), Money::fromCents(-1850));
+}
+
+QObject *createLedgerTest() {
+    return new LedgerTest;
+}
+
+#include "tst_ledger.moc"
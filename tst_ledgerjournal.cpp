@@ -0,0 +1,331 @@
+// tst_ledgerjournal.cpp
+// Crash safety of the snapshot + journal pair: every edit is on disk once it
+// returns, so a copy of the folder taken at any moment (what a crash or power
+// loss leaves behind) loads back to exactly the edits made until then.
+#include "ledger.h"
+#include "ledgerbinary.h"
+#include "tst_support.h"
+
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QTemporaryDir>
+
+#include <cstddef>
+#include <cstring>
+#include <random>
+
+static QByteArray readFile(const QString &path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+static bool writeFile(const QString &path, const QByteArray &data) {
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+// What a crash right now would leave behind
+static bool copyFolder(const QString &from, const QString &to) {
+    QDir().mkpath(to);
+    for (const QString &name : QDir(from).entryList(QDir::Files)) {
+        QFile::remove(to + "/" + name);
+        if (!QFile::copy(from + "/" + name, to + "/" + name)) return false;
+    }
+    return true;
+}
+
+static QMap<int, QString> contents(const Ledger &ledger) {
+    QMap<int, QString> rows;
+    for (const Transaction &trans : ledger.transactions().toVector()) {
+        rows.insert(trans.id, trans.description);
+    }
+    return rows;
+}
+
+static Transaction oneTime(const QString &description, int day = 0) {
+    Transaction trans;
+    trans.description = description;
+    trans.startDate = QDate(2026, 1, 1).addDays(day);
+    trans.amount = Money::fromCents(100 + day);
+    return trans;
+}
+
+class LedgerJournalTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void replaysJournalOverSnapshot();
+    void tornAppendLosesOnlyThatRecord();
+    void crashBeforeJournalTrim();
+    void crashAtEveryStep();
+    void unreadableSnapshotIsNeverReplaced();
+    void corruptRecordFailsTheLoad();
+    void binarySnapshotMatchesJson();
+};
+
+void LedgerJournalTest::replaysJournalOverSnapshot() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QMap<int, QString> expected;
+    {
+        Ledger ledger(dir.path());
+        QVERIFY(ledger.load());
+        for (int i = 0; i < 3; ++i) {
+            ledger.add(oneTime(QString("saved %1").arg(i), i));
+        }
+        QVERIFY(ledger.save());
+        int kept = ledger.add(oneTime("journaled", 5));
+        int gone = ledger.add(oneTime("deleted", 6));
+        QCOMPARE(ledger.remove({ gone, 0 }), 2);
+        QVERIFY(kept >= 0);
+        expected = contents(ledger);
+    }
+
+    Ledger reloaded(dir.path());
+    QVERIFY(reloaded.load());
+    QCOMPARE(contents(reloaded), expected);
+    QVERIFY(!reloaded.transactions().contains(0));
+}
+
+void LedgerJournalTest::tornAppendLosesOnlyThatRecord() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString journalPath = dir.filePath("transactions.journal");
+
+    qint64 before = 0;
+    {
+        Ledger ledger(dir.path());
+        QVERIFY(ledger.load());
+        ledger.add(oneTime("first"));
+        before = readFile(journalPath).size();
+        ledger.add(oneTime("torn", 1));
+    }
+    QByteArray full = readFile(journalPath);
+    QVERIFY(full.size() > before);
+
+    // A crash can cut the last line anywhere, newline included
+    for (qint64 cut = before; cut < full.size(); ++cut) {
+        QVERIFY(writeFile(journalPath, full.left(cut)));
+
+        int added = -1;
+        {
+            Ledger ledger(dir.path());
+            QVERIFY(ledger.load());
+            QCOMPARE(ledger.transactions().size(), 1);
+            QCOMPARE(ledger.transaction(0).description, QString("first"));
+
+            // The torn tail is cut off, so the next record isn't glued to it
+            added = ledger.add(oneTime("after", 2));
+        }
+
+        Ledger reloaded(dir.path());
+        QVERIFY(reloaded.load());
+        QCOMPARE(reloaded.transactions().size(), 2);
+        QCOMPARE(reloaded.transaction(added).description, QString("after"));
+    }
+}
+
+void LedgerJournalTest::crashBeforeJournalTrim() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString journalPath = dir.filePath("transactions.journal");
+
+    QMap<int, QString> expected;
+    QByteArray untrimmed;
+    {
+        Ledger ledger(dir.path());
+        QVERIFY(ledger.load());
+        for (int i = 0; i < 5; ++i) {
+            ledger.add(oneTime(QString("row %1").arg(i), i));
+        }
+        ledger.remove({ 2 });
+        untrimmed = readFile(journalPath);
+        QVERIFY(ledger.save());
+        expected = contents(ledger);
+    }
+    QVERIFY(readFile(journalPath).isEmpty());
+
+    // The new snapshot made it, the trim didn't: its records must not replay twice
+    QVERIFY(writeFile(journalPath, untrimmed));
+    Ledger ledger(dir.path());
+    QVERIFY(ledger.load());
+    QCOMPARE(contents(ledger), expected);
+
+    int id = ledger.add(oneTime("next"));
+    QVERIFY(!expected.contains(id));
+}
+
+void LedgerJournalTest::crashAtEveryStep() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    std::mt19937 random(4);
+    Ledger ledger(dir.path());
+    QVERIFY(ledger.load());
+    QMap<int, QString> model;
+
+    for (int step = 0; step < 200; ++step) {
+        int op = int(random() % 10);
+        if (op < 6 || model.isEmpty()) {
+            Transaction trans = oneTime(QString("step %1").arg(step), int(random() % 400));
+            int id = ledger.add(trans);
+            QVERIFY(id >= 0);
+            model.insert(id, trans.description);
+        } else if (op < 9) {
+            QVector<int> ids = model.keys();
+            int id = ids.at(int(random() % ids.size()));
+            QCOMPARE(ledger.remove({ id }), 1);
+            model.remove(id);
+        } else {
+            QVERIFY(ledger.save());
+        }
+
+        QString crashed = dir.filePath(QString("crash-%1").arg(step));
+        QVERIFY(copyFolder(dir.path(), crashed));
+        Ledger recovered(crashed);
+        QVERIFY2(recovered.load(), qPrintable(QString("step %1").arg(step)));
+        QVERIFY2(contents(recovered) == model, qPrintable(QString("step %1").arg(step)));
+        QDir(crashed).removeRecursively();
+    }
+}
+
+void LedgerJournalTest::unreadableSnapshotIsNeverReplaced() {
+    for (bool binary : { false, true }) {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QString snapshotPath = dir.filePath(binary ? "transactions.mcl" : "transactions.json");
+
+        {
+            Ledger ledger(dir.path());
+            QVERIFY(ledger.load());
+            for (int i = 0; i < 20; ++i) {
+                ledger.add(oneTime(QString("row %1").arg(i), i));
+            }
+            QVERIFY(ledger.save());
+            ledger.add(oneTime("journaled"));
+        }
+        if (binary) {
+            QVERIFY(LedgerJournal::convertSnapshot(dir.filePath("transactions.json"), snapshotPath));
+            QFile::remove(dir.filePath("transactions.json"));
+        }
+
+        // Half a JSON file, or a binary one whose header is intact up to the magic
+        QByteArray damaged = readFile(snapshotPath);
+        damaged = binary ? damaged.left(4) + QByteArray(64, '\xff') : damaged.left(damaged.size() / 2);
+        QVERIFY(writeFile(snapshotPath, damaged));
+        QByteArray journal = readFile(dir.filePath("transactions.journal"));
+
+        {
+            Ledger ledger(dir.path());
+            QVERIFY(!ledger.load());
+            QVERIFY(ledger.isReadOnly());
+            QCOMPARE(ledger.transactions().size(), 0);
+            QCOMPARE(ledger.add(oneTime("lost")), -1);
+            ledger.save();
+        }
+
+        // Still there for whoever repairs it by hand
+        QCOMPARE(readFile(snapshotPath), damaged);
+        QCOMPARE(readFile(dir.filePath("transactions.journal")), journal);
+        QVERIFY(!QFile::exists(dir.filePath(binary ? "transactions.json" : "transactions.mcl")));
+    }
+}
+
+// A binary snapshot whose header is fine but one record's description points
+// past the string pool: the load fails rather than dropping that row
+void LedgerJournalTest::corruptRecordFailsTheLoad() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString snapshotPath = dir.filePath("transactions.mcl");
+
+    QVector<Transaction> rows;
+    for (int i = 0; i < 3; ++i) {
+        Transaction trans = oneTime(QString("row %1").arg(i), i);
+        trans.id = i;
+        rows.append(trans);
+    }
+    QVERIFY(LedgerBinary::write(snapshotPath, rows, 3, 0));
+
+    QByteArray damaged = readFile(snapshotPath);
+    LedgerBinary::FileHeader header;
+    std::memcpy(&header, damaged.constData(), sizeof(header));
+    quint32 offset = header.poolLength + 1;
+    std::memcpy(damaged.data() + sizeof(header) + sizeof(LedgerBinary::Record)
+                    + offsetof(LedgerBinary::Record, descriptionOffset),
+                &offset, sizeof(offset));
+    QVERIFY(writeFile(snapshotPath, damaged));
+
+    {
+        Ledger ledger(dir.path());
+        QVERIFY(!ledger.load());
+        QVERIFY(ledger.isReadOnly());
+        QCOMPARE(ledger.transactions().size(), 0);
+        QCOMPARE(ledger.add(oneTime("lost")), -1);
+        ledger.save();
+    }
+
+    QCOMPARE(readFile(snapshotPath), damaged);
+    QVERIFY(!QFile::exists(dir.filePath("transactions.json")));
+}
+
+void LedgerJournalTest::binarySnapshotMatchesJson() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString jsonPath = dir.filePath("transactions.json");
+    QString binaryPath = dir.filePath("transactions.mcl");
+
+    // No start date, and fields outside the ranges the engine uses
+    QVERIFY(writeFile(jsonPath, R"({"nextId": 3, "journalSeq": 7, "transactions": [
+        {"id": 0, "description": "undated", "amountCents": 100, "recurrence": 0},
+        {"id": 1, "description": "rent", "amountCents": -500, "recurrence": 6, "startDate": "2026-01-01",
+         "weekOfMonth": 9, "occurrenceLimit": -4, "intervalMonths": 0},
+        {"id": 2, "description": "every 3 days", "amountCents": 7, "recurrence": 5, "startDate": "2026-02-03",
+         "intervalDays": 3, "endDate": "2026-12-31", "occurrenceLimit": 10}]})"));
+    QVERIFY(LedgerJournal::convertSnapshot(jsonPath, binaryPath));
+
+    LedgerJournal journal(dir.path());
+    QVector<Transaction> fromJson, fromBinary;
+    int jsonNextId = 0, binaryNextId = 0;
+    QVERIFY(journal.loadSnapshot(jsonPath, fromJson, jsonNextId));
+    {
+        LedgerJournal binaryJournal(dir.path());
+        QVERIFY(binaryJournal.loadSnapshot(binaryPath, fromBinary, binaryNextId));
+        QCOMPARE(binaryNextId, jsonNextId);
+        QCOMPARE(fromBinary.size(), fromJson.size());
+        for (int i = 0; i < fromJson.size(); ++i) {
+            QCOMPARE(fromBinary[i].id, fromJson[i].id);
+            QCOMPARE(fromBinary[i].description, fromJson[i].description);
+            QCOMPARE(fromBinary[i].startDate, fromJson[i].startDate);
+            QCOMPARE(fromBinary[i].endDate, fromJson[i].endDate);
+            QCOMPARE(fromBinary[i].weekOfMonth, fromJson[i].weekOfMonth);
+            QCOMPARE(fromBinary[i].occurrenceLimit, fromJson[i].occurrenceLimit);
+        }
+        QVERIFY(!fromBinary[0].startDate.isValid());
+        QCOMPARE(fromBinary[1].weekOfMonth, -1);
+        QCOMPARE(fromBinary[2].intervalDays, 3);
+    }
+
+    // A file from elsewhere gets the same ranges as a JSON one
+    QByteArray data = readFile(binaryPath);
+    LedgerBinary::Record record;
+    char *first = data.data() + sizeof(LedgerBinary::FileHeader);
+    std::memcpy(&record, first, sizeof(record));
+    record.schedule = quint32(RecurrenceType::NthWeekday) | (0u << 8) | (quint32(quint8(qint8(-7))) << 24);
+    record.occurrenceLimit = -1;
+    std::memcpy(first, &record, sizeof(record));
+    QVERIFY(writeFile(binaryPath, data));
+
+    LedgerJournal patchedJournal(dir.path());
+    QVERIFY(patchedJournal.loadSnapshot(binaryPath, fromBinary, binaryNextId));
+    QCOMPARE(fromBinary[0].intervalMonths, 1);
+    QCOMPARE(fromBinary[0].weekOfMonth, -1);
+    QCOMPARE(fromBinary[0].occurrenceLimit, 0);
+}
+
+QObject *createLedgerJournalTest() {
+    return new LedgerJournalTest;
+}
+
+#include "tst_ledgerjournal.moc"
@@ -0,0 +1,53 @@
+// tst_ledgerverifier.cpp
+// The seeded differential run of moneycalendar-cli --verify, so `make check`
+// compares every fast path (binary snapshots included) with the reference.
+#include "ledgerverifier.h"
+#include "tst_support.h"
+
+class LedgerVerifierTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void seededLedgers_data();
+    void seededLedgers();
+    void damagedSnapshots();
+};
+
+void LedgerVerifierTest::seededLedgers_data() {
+    QTest::addColumn<quint32>("seed");
+    for (quint32 seed = 1; seed <= 4; ++seed) {
+        QTest::newRow(qPrintable(QString("seed %1").arg(seed))) << seed;
+    }
+}
+
+void LedgerVerifierTest::seededLedgers() {
+    QFETCH(quint32, seed);
+    LedgerVerifier::Report report = LedgerVerifier::run(seed, 64);
+    QVERIFY2(report.ok(), qPrintable(report.failures.join('\n')));
+    QCOMPARE(report.ledgers, 64);
+    QVERIFY(report.checks > 0);
+}
+
+// What the fuzz target starts from: nothing may crash, and what loads must agree
+void LedgerVerifierTest::damagedSnapshots() {
+    QByteArray snapshot = R"({"nextId": 4, "transactions": [
+        {"id": 0, "startDate": "2024-01-31", "amountCents": -120000, "recurrence": 3, "description": "rent"},
+        {"id": 1, "startDate": "2024-02-29", "amountCents": 5000, "recurrence": 4, "intervalMonths": 12},
+        {"id": 2, "startDate": "2024-03-01", "amountCents": 700, "recurrence": 5, "intervalDays": 0},
+        {"id": 3, "startDate": "2024-03-05", "amountCents": 900, "recurrence": 6, "weekOfMonth": 9,
+         "occurrenceLimit": -2, "endDate": "2023-01-01"}]})";
+
+    LedgerVerifier::Report report;
+    for (int cut = 0; cut <= snapshot.size(); cut += 7) {
+        LedgerVerifier::checkSnapshot(snapshot.left(cut), report);
+    }
+    LedgerVerifier::checkSnapshot(snapshot, report);
+    QVERIFY2(report.ok(), qPrintable(report.failures.join('\n')));
+    QVERIFY(report.ledgers >= 1);
+}
+
+QObject *createLedgerVerifierTest() {
+    return new LedgerVerifierTest;
+}
+
+#include "tst_ledgerverifier.moc"
@@ -0,0 +1,56 @@
+// tst_main.cpp
+// Runs the engine's test classes one after another, as `make check` does. A
+// class name as the first argument runs just that class, and QTest's usual
+// options after it apply to it: moneycalendar-tests RecurrenceTest -v2
+#include <QCoreApplication>
+#include <QDebug>
+#include <QtTest>
+
+#include <memory>
+
+// One per tst_*.cpp
+QObject *createRecurrenceTest();
+QObject *createBalanceTimelineTest();
+QObject *createLedgerTest();
+QObject *createLedgerJournalTest();
+QObject *createLedgerVerifierTest();
+QObject *createMoneyTest();
+QObject *createStatementReaderTest();
+
+typedef QObject *(*TestFactory)();
+static const TestFactory testFactories[] = {
+    createRecurrenceTest,
+    createBalanceTimelineTest,
+    createLedgerTest,
+    createLedgerJournalTest,
+    createLedgerVerifierTest,
+    createMoneyTest,
+    createStatementReaderTest,
+};
+
+int main(int argc, char **argv) {
+    QCoreApplication app(argc, argv);
+
+    const char *only = (argc > 1 && argv[1][0] != '-') ? argv[1] : nullptr;
+    int failed = 0;
+    bool ran = false;
+    for (TestFactory create : testFactories) {
+        std::unique_ptr<QObject> test(create());
+        if (only && qstrcmp(test->metaObject()->className(), only) != 0) continue;
+
+        ran = true;
+        if (only) {
+            argv[1] = argv[0];
+            failed += QTest::qExec(test.get(), argc - 1, argv + 1);
+            argv[1] = const_cast<char *>(only);
+        } else {
+            failed += QTest::qExec(test.get(), argc, argv);
+        }
+    }
+
+    if (!ran) {
+        qWarning() << "No test class named" << only;
+        return 1;
+    }
+    return failed;
+}
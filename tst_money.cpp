@@ -0,0 +1,155 @@
+// tst_money.cpp
+// Balances in whole cents: fifty years of small recurring amounts add up to
+// exactly what a day-by-day integer sum says, and what cancels out is zero.
+#include "balancetimeline.h"
+#include "money.h"
+#include "transactionstore.h"
+#include "tst_support.h"
+
+#include <QHash>
+
+#include <limits>
+#include <random>
+
+static const QDate Start(2025, 1, 1);
+static const QDate End = Start.addYears(50).addDays(-1);
+
+// Every occurrence up to End stepped through one by one, as the old loop did,
+// summed per day in plain integers
+static void addOccurrences(const Transaction &trans, QHash<qint64, qint64> &centsOnDay) {
+    QDate current = trans.startDate;
+    while (current <= End) {
+        centsOnDay[current.toJulianDay()] += trans.amount.cents();
+        switch (trans.recurrence) {
+        case RecurrenceType::None:       return;
+        case RecurrenceType::Weekly:     current = current.addDays(7); break;
+        case RecurrenceType::BiWeekly:   current = current.addDays(14); break;
+        case RecurrenceType::EveryNDays: current = current.addDays(trans.intervalDays); break;
+        default:                         current = current.addMonths(trans.intervalMonths); break;
+        }
+    }
+}
+
+// Amounts a double sum can't hold exactly, on every kind of schedule
+static QVector<Transaction> smallAmounts(quint32 seed, int count) {
+    static const qint64 Cents[] = { 1, 7, 10, 33, -10, -30, 99, -1 };
+    std::mt19937 random(seed);
+    QVector<Transaction> ledger;
+    for (int i = 0; i < count; ++i) {
+        Transaction trans;
+        trans.id = i;
+        trans.startDate = Start.addDays(qint64(random() % 3650) - 365);
+        trans.amount = Money::fromCents(Cents[random() % 8]);
+        trans.recurrence = RecurrenceType(random() % 6);
+        trans.intervalMonths = (trans.recurrence == RecurrenceType::EveryNMonths) ? 2 + int(random() % 11) : 1;
+        trans.intervalDays = 1 + int(random() % 30);
+        ledger.append(trans);
+    }
+    return ledger;
+}
+
+class MoneyTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void saturatesInsteadOfWrapping();
+    void fiftyYearBalancesAreExact_data();
+    void fiftyYearBalancesAreExact();
+    void cancellingAmountsNetToZero();
+};
+
+void MoneyTest::saturatesInsteadOfWrapping() {
+    const Money max = Money::fromCents(std::numeric_limits<qint64>::max());
+    const Money min = Money::fromCents(std::numeric_limits<qint64>::min());
+
+    QCOMPARE(max + Money::fromCents(1), max);
+    QCOMPARE(min - Money::fromCents(1), min);
+    QCOMPARE(Money::fromCents(1LL << 62) * 4, max);
+    QCOMPARE(Money::fromCents(-(1LL << 62)) * 4, min);
+    QCOMPARE(Money::fromCents(5) * -3, Money::fromCents(-15));
+    QCOMPARE(min.toString(), QString("-92233720368547758.08"));
+    QCOMPARE(Money::fromDouble(0.1 + 0.2), Money::fromCents(30));
+    QCOMPARE(Money::fromDouble(-1e30), min);
+
+    // A ledger whose balance outgrows 64 bits stops at the limit
+    TransactionStore store;
+    Transaction huge;
+    huge.id = 0;
+    huge.startDate = Start;
+    huge.amount = Money::fromCents(1LL << 60);
+    huge.recurrence = RecurrenceType::Weekly;
+    QVERIFY(store.add(huge));
+    QCOMPARE(store.balanceUpTo(Start.addDays(7 * 6)), Money::fromCents(7LL << 60));
+    QCOMPARE(store.balanceUpTo(End), max);
+}
+
+void MoneyTest::fiftyYearBalancesAreExact_data() {
+    QTest::addColumn<quint32>("seed");
+    QTest::addColumn<int>("count");
+    QTest::newRow("one") << quint32(1) << 1;
+    QTest::newRow("ten") << quint32(2) << 10;
+    QTest::newRow("hundreds") << quint32(3) << 300;
+}
+
+void MoneyTest::fiftyYearBalancesAreExact() {
+    QFETCH(quint32, seed);
+    QFETCH(int, count);
+
+    QVector<Transaction> ledger = smallAmounts(seed, count);
+    TransactionStore store;
+    store.assign(ledger);
+
+    QHash<qint64, qint64> centsOnDay;
+    qint64 opening = 0;
+    for (const Transaction &trans : ledger) {
+        addOccurrences(trans, centsOnDay);
+    }
+    for (auto it = centsOnDay.constBegin(); it != centsOnDay.constEnd(); ++it) {
+        if (it.key() < Start.toJulianDay()) opening += it.value();
+    }
+
+    BalanceTimeline timeline;
+    QVERIFY(timeline.rebuild(store, Start, End));
+
+    qint64 balance = opening;
+    for (QDate date = Start; date <= End; date = date.addDays(1)) {
+        qint64 net = centsOnDay.value(date.toJulianDay());
+        balance += net;
+        QCOMPARE(timeline.netOn(date), Money::fromCents(net));
+        QCOMPARE(timeline.balanceOn(date), Money::fromCents(balance));
+        if (date.day() == 1 && date.month() == 1) {
+            QCOMPARE(store.balanceUpTo(date), Money::fromCents(balance));
+            QCOMPARE(store.netOn(date), Money::fromCents(net));
+        }
+    }
+    QCOMPARE(store.balanceUpTo(End), Money::fromCents(balance));
+}
+
+// +0.10 and -0.10 on the same schedules: in doubles their sum drifts away
+// from zero, which painted days that cancel out as income or expense
+void MoneyTest::cancellingAmountsNetToZero() {
+    QVector<Transaction> ledger = smallAmounts(4, 100);
+    int size = int(ledger.size());
+    for (int i = 0; i < size; ++i) {
+        Transaction opposite = ledger[i];
+        opposite.id = size + i;
+        opposite.amount = -opposite.amount;
+        ledger.append(opposite);
+    }
+    TransactionStore store;
+    store.assign(ledger);
+
+    BalanceTimeline timeline;
+    QVERIFY(timeline.rebuild(store, Start, End));
+    for (QDate date = Start; date <= End; date = date.addDays(1)) {
+        QVERIFY(timeline.netOn(date).isZero());
+        QVERIFY(timeline.balanceOn(date).isZero());
+    }
+    QVERIFY(store.balanceUpTo(End).isZero());
+}
+
+QObject *createMoneyTest() {
+    return new MoneyTest;
+}
+
+#include "tst_money.moc"
@@ -0,0 +1,231 @@
+// tst_recurrence.cpp
+// Closed-form occurrence counting against the loop it replaced, which
+// stepped through every occurrence with addDays / addMonths.
+#include "occurrenceindex.h"
+#include "recurrence.h"
+#include "transactionstore.h"
+#include "tst_support.h"
+
+#include <algorithm>
+#include <random>
+
+// calculateBalance's old loop, for one transaction
+static int steppedCount(const Transaction &trans, const QDate &upToDate) {
+    if (trans.recurrence == RecurrenceType::None) {
+        return trans.startDate <= upToDate ? 1 : 0;
+    }
+
+    int count = 0;
+    QDate current = trans.startDate;
+    while (current <= upToDate) {
+        ++count;
+        switch (trans.recurrence) {
+        case RecurrenceType::Weekly:   current = current.addDays(7); break;
+        case RecurrenceType::BiWeekly: current = current.addDays(14); break;
+        case RecurrenceType::Monthly:  current = current.addMonths(1); break;
+        default:                       current = current.addMonths(trans.intervalMonths); break;
+        }
+    }
+    return count;
+}
+
+// Month ends and leap days are where counting in closed form goes wrong
+static QDate randomDate(std::mt19937 &random) {
+    QDate date = QDate(1990, 1, 1).addDays(random() % (365 * 50));
+    switch (random() % 4) {
+    case 0:  return QDate(date.year(), date.month(), date.daysInMonth());
+    case 1:  return QDate(date.year(), date.month(), qMin(29 + int(random() % 3), date.daysInMonth()));
+    default: return date;
+    }
+}
+
+static Transaction randomSchedule(std::mt19937 &random, int id) {
+    Transaction trans;
+    trans.id = id;
+    trans.startDate = randomDate(random);
+    trans.amount = Money::fromCents(qint64(random() % 200000) - 100000);
+    trans.recurrence = RecurrenceType(random() % 5);   // the kinds the old loop knew
+    trans.intervalMonths = (trans.recurrence == RecurrenceType::EveryNMonths) ? 2 + int(random() % 11) : 1;
+    return trans;
+}
+
+// Any kind, possibly with an end date or an occurrence limit
+static Transaction randomRule(std::mt19937 &random, int id) {
+    Transaction trans = randomSchedule(random, id);
+    trans.recurrence = RecurrenceType(random() % 8);
+    if (trans.recurrence == RecurrenceType::NthWeekday || trans.recurrence == RecurrenceType::LastBusinessDay) {
+        trans.intervalMonths = 1 + int(random() % 12);
+    }
+    trans.intervalDays = 1 + int(random() % 60);
+    int day = trans.startDate.day();
+    trans.weekOfMonth = (day <= 28) ? (day - 1) / 7 + 1 : -1;   // as AddTransactionDialog sets it
+    switch (random() % 3) {
+    case 0:  trans.endDate = trans.startDate.addDays(qint64(random() % (365 * 10))); break;
+    case 1:  trans.occurrenceLimit = 1 + int(random() % 50); break;
+    default: break;
+    }
+    return trans;
+}
+
+static QString describeSchedule(const Transaction &trans, const QDate &date) {
+    return QString("%1 from %2, up to %3").arg(Recurrence::describe(trans), trans.startDate.toString(Qt::ISODate),
+                                               date.toString(Qt::ISODate));
+}
+
+class RecurrenceTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void monthEndCarriesForward();
+    void leapDayCarriesForward();
+    void matchesSteppingOnRandomSchedules();
+    void storeMatchesStepping();
+    void membershipMatchesCounting();
+};
+
+void RecurrenceTest::monthEndCarriesForward() {
+    Transaction rent;
+    rent.startDate = QDate(2025, 1, 31);
+    rent.recurrence = RecurrenceType::Monthly;
+
+    QCOMPARE(Recurrence::nthOccurrence(rent, 1), QDate(2025, 2, 28));
+    QCOMPARE(Recurrence::nthOccurrence(rent, 2), QDate(2025, 3, 28));
+    QCOMPARE(Recurrence::nthOccurrence(rent, 11), QDate(2025, 12, 28));
+    QCOMPARE(Recurrence::occurrencesUpTo(rent, QDate(2025, 3, 27)), 2);
+    QCOMPARE(Recurrence::occurrencesUpTo(rent, QDate(2025, 3, 28)), 3);
+    QCOMPARE(Recurrence::occurrencesUpTo(rent, QDate(2025, 3, 31)), 3);
+
+    Recurrence::Rule rule = Recurrence::Rule::compile(rent);
+    QVERIFY(rule.occursOn(QDate(2025, 3, 28).toJulianDay()));
+    QVERIFY(!rule.occursOn(QDate(2025, 3, 31).toJulianDay()));
+
+    // A 30-day month only takes the 31st down to the 30th
+    Transaction bill;
+    bill.startDate = QDate(2025, 8, 31);
+    bill.recurrence = RecurrenceType::EveryNMonths;
+    bill.intervalMonths = 2;
+    QCOMPARE(Recurrence::nthOccurrence(bill, 1), QDate(2025, 10, 31));
+    QCOMPARE(Recurrence::nthOccurrence(bill, 3), QDate(2026, 2, 28));
+    QCOMPARE(Recurrence::nthOccurrence(bill, 4), QDate(2026, 4, 28));
+
+    Transaction quarterly = bill;
+    quarterly.startDate = QDate(2025, 5, 31);
+    quarterly.intervalMonths = 3;
+    QCOMPARE(Recurrence::nthOccurrence(quarterly, 1), QDate(2025, 8, 31));
+    QCOMPARE(Recurrence::nthOccurrence(quarterly, 2), QDate(2025, 11, 30));
+    QCOMPARE(Recurrence::nthOccurrence(quarterly, 3), QDate(2026, 2, 28));
+}
+
+void RecurrenceTest::leapDayCarriesForward() {
+    Transaction trans;
+    trans.startDate = QDate(2024, 1, 30);
+    trans.recurrence = RecurrenceType::Monthly;
+
+    QCOMPARE(Recurrence::nthOccurrence(trans, 1), QDate(2024, 2, 29));
+    QCOMPARE(Recurrence::nthOccurrence(trans, 2), QDate(2024, 3, 29));
+    QCOMPARE(Recurrence::nthOccurrence(trans, 13), QDate(2025, 2, 28));
+    QCOMPARE(Recurrence::nthOccurrence(trans, 14), QDate(2025, 3, 28));
+
+    // Yearly on a leap day: every Feb 28 after the first
+    Transaction yearly;
+    yearly.startDate = QDate(2024, 2, 29);
+    yearly.recurrence = RecurrenceType::EveryNMonths;
+    yearly.intervalMonths = 12;
+    QCOMPARE(Recurrence::nthOccurrence(yearly, 4), QDate(2028, 2, 28));
+    QCOMPARE(Recurrence::occurrencesUpTo(yearly, QDate(2028, 2, 28)), 5);
+}
+
+void RecurrenceTest::matchesSteppingOnRandomSchedules() {
+    std::mt19937 random(1);
+    for (int i = 0; i < 2000; ++i) {
+        Transaction trans = randomSchedule(random, i);
+        for (int n = 0; n < 8; ++n) {
+            QDate date = trans.startDate.addDays(qint64(random() % (365 * 50)) - 30);
+            QVERIFY2(Recurrence::occurrencesUpTo(trans, date) == steppedCount(trans, date),
+                     qPrintable(describeSchedule(trans, date)));
+        }
+    }
+}
+
+void RecurrenceTest::storeMatchesStepping() {
+    std::mt19937 random(2);
+    QVector<Transaction> transactions;
+    for (int i = 0; i < 500; ++i) {
+        transactions.append(randomSchedule(random, i));
+    }
+    TransactionStore store;
+    store.assign(transactions);
+
+    for (int n = 0; n < 60; ++n) {
+        QDate date = randomDate(random).addYears(int(random() % 30));
+        Money balance, net;
+        for (const Transaction &trans : transactions) {
+            int count = steppedCount(trans, date);
+            balance += trans.amount * count;
+            if (count > steppedCount(trans, date.addDays(-1))) net += trans.amount;
+        }
+        QCOMPARE(store.balanceUpTo(date), balance);
+        QCOMPARE(store.netOn(date), net);
+    }
+}
+
+// A day is an occurrence exactly when the count goes up on it, and then it is
+// the n-th one; the occurrence index (which the calendar asks) agrees with both
+void RecurrenceTest::membershipMatchesCounting() {
+    std::mt19937 random(3);
+    QVector<Transaction> transactions;
+    for (int i = 0; i < 400; ++i) {
+        Transaction trans = randomRule(random, i);
+        Recurrence::Rule rule = Recurrence::Rule::compile(trans);
+        transactions.append(trans);
+
+        // The first year and a few more anywhere in the next fifty
+        QVector<qint64> windows = { trans.startDate.toJulianDay() - 3 };
+        for (int n = 0; n < 3; ++n) {
+            windows.append(trans.startDate.toJulianDay() + qint64(random() % (365 * 50)));
+        }
+        for (qint64 first : windows) {
+            int before = rule.countUpTo(first - 1);
+            for (qint64 day = first; day < first + 400; ++day) {
+                int count = rule.countUpTo(day);
+                bool occurs = count > before;
+                if ((count != before && count != before + 1) || rule.occursOn(day) != occurs
+                    || (occurs && rule.nthDay(count - 1) != day)) {
+                    QFAIL(qPrintable(describeSchedule(trans, QDate::fromJulianDay(day))));
+                }
+                before = count;
+            }
+        }
+    }
+
+    TransactionStore store;
+    store.assign(transactions);
+    OccurrenceIndex index;
+    index.rebuild(store);
+    QVector<Recurrence::Rule> rules;
+    for (const Transaction &trans : transactions) {
+        rules.append(Recurrence::Rule::compile(trans));
+    }
+    for (int n = 0; n < 300; ++n) {
+        QDate date = randomDate(random).addYears(int(random() % 20));
+        QVector<int> expected;
+        Money net;
+        for (const Transaction &trans : transactions) {
+            if (rules[trans.id].occursOn(date.toJulianDay())) {
+                expected.append(trans.id);
+                net += trans.amount;
+            }
+        }
+        QVector<int> ids = index.transactionsOn(date);
+        std::sort(ids.begin(), ids.end());
+        QCOMPARE(ids, expected);
+        QCOMPARE(index.netAmountOn(date), net);
+        QCOMPARE(store.netOn(date), net);
+    }
+}
+
+QObject *createRecurrenceTest() {
+    return new RecurrenceTest;
+}
+
+#include "tst_recurrence.moc"
@@ -0,0 +1,50 @@
+// tst_statementreader.cpp
+// Amounts as bank exports write them, parsed exactly to cents.
+#include "statementreader.h"
+#include "tst_support.h"
+
+class StatementReaderTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void parseAmount_data();
+    void parseAmount();
+};
+
+void StatementReaderTest::parseAmount_data() {
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<bool>("ok");
+    QTest::addColumn<qint64>("cents");
+
+    QTest::newRow("plain") << QByteArray("12.34") << true << qint64(1234);
+    QTest::newRow("whole") << QByteArray("$3") << true << qint64(300);
+    QTest::newRow("one decimal") << QByteArray("-1,234.5") << true << qint64(-123450);
+    QTest::newRow("parentheses") << QByteArray("(12.00)") << true << qint64(-1200);
+    QTest::newRow("trailing minus") << QByteArray("4.20-") << true << qint64(-420);
+    QTest::newRow("decimal comma") << QByteArray("1.234,56") << true << qint64(123456);
+    QTest::newRow("grouping only") << QByteArray("1,234") << true << qint64(123400);
+    QTest::newRow("no leading digit") << QByteArray(".50") << true << qint64(50);
+    QTest::newRow("negative, no leading digit") << QByteArray("-.99") << true << qint64(-99);
+    QTest::newRow("comma, no leading digit") << QByteArray(",5") << true << qint64(50);
+    QTest::newRow("abbreviation dot") << QByteArray("Rs. 12") << true << qint64(1200);
+    QTest::newRow("spaces") << QByteArray(" 1 234.00 ") << true << qint64(123400);
+    QTest::newRow("empty") << QByteArray("") << false << qint64(0);
+    QTest::newRow("only a point") << QByteArray(".") << false << qint64(0);
+    QTest::newRow("two numbers") << QByteArray("12 USD 34") << false << qint64(0);
+}
+
+void StatementReaderTest::parseAmount() {
+    QFETCH(QByteArray, text);
+    QFETCH(bool, ok);
+    QFETCH(qint64, cents);
+
+    Money amount;
+    QCOMPARE(StatementReader::parseAmount(text, amount), ok);
+    if (ok) QCOMPARE(amount, Money::fromCents(cents));
+}
+
+QObject *createStatementReaderTest() {
+    return new StatementReaderTest;
+}
+
+#include "tst_statementreader.moc"
@@ -0,0 +1,14 @@
+// tst_support.h
+#ifndef TST_SUPPORT_H
+#define TST_SUPPORT_H
+
+#include <QtTest>
+
+#include "money.h"
+
+// So a failed QCOMPARE shows the amounts
+inline char *toString(const Money &money) {
+    return QTest::toString(money.toString());
+}
+
+#endif // TST_SUPPORT_H
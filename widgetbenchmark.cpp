@@ -0,0 +1,139 @@
+// widgetbenchmark.cpp
+// Times the calendar widget itself, which moneycalendar-cli can't as it has no
+// QtWidgets, and prints the same JSON as moneycalendar-cli --benchmark:
+//
+//   moneycalendar-widgetbench [--sizes N,...] [--min-time SECONDS]
+//
+// Runs on the offscreen platform unless QT_QPA_PLATFORM says otherwise, so it
+// needs no display. Each repaint is a QWidget::grab of the whole month page,
+// every cell painted from a finished projection of a synthetic ledger.
+#include "customcalendar.h"
+#include "ledger.h"
+#include "ledgerbenchmark.h"
+#include "ledgerjournal.h"
+#include "projectionservice.h"
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+// Written once per ledger size so the timed work can't be optimised away
+static volatile qint64 benchmarkSink;
+
+// Pages a year apart across the synthetic ledger's ten years
+static const int PageCount = 8;
+
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName("moneycalendar-widgetbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times repaints of the calendar widget and prints JSON.");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Ledger sizes, default 1000,100000.", "n,...");
+    QCommandLineOption minTimeOption("min-time", "Minimum seconds per benchmark, default 0.5.", "seconds", "0.5");
+    parser.addOptions({ sizesOption, minTimeOption });
+    parser.process(app);
+
+    QTextStream err(stderr);
+    QVector<int> sizes = { 1000, 100000 };
+    if (parser.isSet(sizesOption)) {
+        sizes.clear();
+        for (const QString &text : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+            bool ok = false;
+            int size = text.toInt(&ok);
+            if (!ok || size <= 0) {
+                err << "Invalid ledger size " << text << '\n';
+                return 1;
+            }
+            sizes.append(size);
+        }
+    }
+
+    bool ok = false;
+    double minSeconds = parser.value(minTimeOption).toDouble(&ok);
+    if (!ok || minSeconds < 0) {
+        err << "Invalid --min-time\n";
+        return 1;
+    }
+    const qint64 minNanos = qint64(minSeconds * 1e9);
+
+    const LedgerBenchmark::Mix mix;
+    QJsonArray results;
+    for (int size : sizes) {
+        QTemporaryDir directory;
+        if (!directory.isValid()) {
+            err << "Could not create a temporary ledger folder\n";
+            return 1;
+        }
+        {
+            TransactionStore initial;
+            initial.assign(LedgerBenchmark::syntheticLedger(size, mix));
+            LedgerJournal(directory.path()).compact(initial, size);
+        }
+        Ledger ledger(directory.path(), true);
+        if (!ledger.load()) {
+            err << "Could not load the synthetic ledger\n";
+            return 1;
+        }
+
+        // One projection covering every page, as the app has one for the
+        // months around the shown page before it paints
+        QVector<QDate> pages;
+        for (int page = 0; page < PageCount; ++page) {
+            pages.append(QDate(2020, 6, 1).addYears(page));
+        }
+        ProjectionService projections;
+        QEventLoop waiting;
+        QObject::connect(&projections, &ProjectionService::projectionReady, &waiting, &QEventLoop::quit);
+        projections.request(ledger.snapshot(), pages.first().addMonths(-1), pages.last().addMonths(2));
+        waiting.exec();
+
+        CustomCalendar calendar;
+        calendar.setProjections(&projections);
+        calendar.resize(800, 600);
+        calendar.show();
+        auto showPage = [&](qint64 i) {
+            const QDate &page = pages[int(i % PageCount)];
+            calendar.setCurrentPage(page.year(), page.month());
+        };
+
+        qint64 checksum = 0;
+
+        // Overlays cached, as on every repaint but the first after a resize
+        results.append(LedgerBenchmark::measure("calendarRepaint", size, minNanos, [&](qint64 i) {
+            showPage(i);
+            checksum += calendar.grab().width();
+        }));
+
+        // The same with the overlays rendered again first, i.e. what the
+        // overlay cache saves each time
+        results.append(LedgerBenchmark::measure("calendarRepaint/uncached", size, minNanos, [&](qint64 i) {
+            showPage(i);
+            calendar.dropOverlays();
+            checksum += calendar.grab().width();
+        }));
+
+        // Every cell still waiting for its projection: pending markers only
+        ProjectionService empty;
+        calendar.setProjections(&empty);
+        results.append(LedgerBenchmark::measure("calendarRepaint/pending", size, minNanos, [&](qint64 i) {
+            showPage(i);
+            checksum += calendar.grab().width();
+        }));
+        calendar.setProjections(&projections);
+
+        benchmarkSink = checksum;
+    }
+
+    QTextStream(stdout) << QJsonDocument(LedgerBenchmark::document(results, mix, minSeconds)).toJson(QJsonDocument::Indented);
+    return 0;
+}
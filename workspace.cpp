@@ -0,0 +1,134 @@
+// workspace.cpp
+#include "workspace.h"
+#include "instrumentation.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+
+// The files of one ledger folder, see LedgerJournal
+static const char *const LedgerFiles[] = { "transactions.json", "transactions.mcl", "transactions.journal" };
+
+Workspace::Workspace(const QString &directory, qint64 memoryBudget)
+    : directory(directory),
+    budget(memoryBudget) {
+    adoptSingleLedger();
+
+    QDir root(this->directory + "/ledgers");
+    for (const QString &name : root.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if (isValidName(name)) ledgers.insert(name, Loaded());
+    }
+}
+
+// Older versions kept one ledger straight in directory; move it into ledgers/
+void Workspace::adoptSingleLedger() {
+    QDir root(directory);
+    if (root.exists("ledgers")) return;
+
+    bool found = false;
+    for (const char *file : LedgerFiles) {
+        found = found || root.exists(file);
+    }
+    if (!found) return;
+
+    QString target = pathOf(FirstLedgerName);
+    if (!QDir().mkpath(target)) {
+        qWarning() << "Could not create ledger folder" << target;
+        return;
+    }
+    for (const char *file : LedgerFiles) {
+        if (root.exists(file) && !QFile::rename(root.filePath(file), target + "/" + file)) {
+            qWarning() << "Could not move" << root.filePath(file) << "to" << target;
+        }
+    }
+}
+
+QString Workspace::pathOf(const QString &name) const {
+    return directory + "/ledgers/" + name;
+}
+
+bool Workspace::isValidName(const QString &name) {
+    static const QString forbidden = "/\\:*?\"<>|";
+    if (name.trimmed() != name || name.isEmpty() || name.startsWith('.')) return false;
+    for (QChar c : name) {
+        if (forbidden.contains(c) || c.unicode() < 32) return false;
+    }
+    return true;
+}
+
+bool Workspace::isLoaded(const QString &name) const {
+    auto found = ledgers.constFind(name);
+    return found != ledgers.constEnd() && found->ledger;
+}
+
+std::shared_ptr<Ledger> Workspace::ledger(const QString &name) {
+    auto found = ledgers.find(name);
+    if (found == ledgers.end()) return nullptr;
+
+    Loaded &loaded = found.value();
+    if (!loaded.ledger) {
+        MC_TRACE_SCOPE("Workspace::load");
+        loaded.ledger = std::make_shared<Ledger>(pathOf(name));
+        if (!loaded.ledger->load()) {
+            qWarning() << "Could not fully load ledger" << name;
+        }
+    }
+    loaded.lastUse = ++useClock;
+    loaded.bytes = loaded.ledger->memoryUsage();
+
+    std::shared_ptr<Ledger> result = loaded.ledger;
+    trim(name);
+    return result;
+}
+
+std::shared_ptr<Ledger> Workspace::create(const QString &name) {
+    if (!isValidName(name) || ledgers.contains(name)) return nullptr;
+
+    if (!QDir().mkpath(pathOf(name))) {
+        qWarning() << "Could not create ledger folder" << pathOf(name);
+        return nullptr;
+    }
+    ledgers.insert(name, Loaded());
+    return ledger(name);
+}
+
+void Workspace::setMemoryBudget(qint64 bytes) {
+    budget = bytes;
+    trim(QString());
+}
+
+qint64 Workspace::memoryInUse() const {
+    qint64 bytes = 0;
+    for (const Loaded &loaded : ledgers) {
+        if (loaded.ledger) bytes += loaded.bytes;
+    }
+    return bytes;
+}
+
+// Drops least recently used ledgers until the rest fit the budget. keep (the
+// one just asked for) and ledgers held elsewhere stay: dropping those would
+// free nothing.
+void Workspace::trim(const QString &keep) {
+    qint64 inUse = memoryInUse();
+    while (inUse > budget) {
+        Loaded *oldest = nullptr;
+        for (auto it = ledgers.begin(); it != ledgers.end(); ++it) {
+            Loaded &loaded = it.value();
+            if (!loaded.ledger || it.key() == keep || loaded.ledger.use_count() > 1) continue;
+            if (!oldest || loaded.lastUse < oldest->lastUse) oldest = &loaded;
+        }
+        if (!oldest) return;
+
+        inUse -= oldest->bytes;
+        oldest->ledger.reset();
+        oldest->bytes = 0;
+    }
+}
+
+bool Workspace::saveAll() {
+    bool ok = true;
+    for (const Loaded &loaded : ledgers) {
+        if (loaded.ledger) ok = loaded.ledger->save() && ok;
+    }
+    return ok;
+}
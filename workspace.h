@@ -0,0 +1,59 @@
+// workspace.h
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+#include "ledger.h"
+
+// Several named ledgers (household, business, escrow, ...) under one folder,
+// each in its own ledgers/<name> sub-folder. A ledger is only loaded the
+// first time it is asked for. Whenever the loaded ones add up to more than
+// the memory budget, the least recently used ones that nobody else holds are
+// dropped again; their edits are already in their journals, so nothing is
+// lost and the next access simply loads them anew.
+class Workspace {
+public:
+    static constexpr qint64 DefaultMemoryBudget = 256 * 1024 * 1024;
+    static constexpr const char *FirstLedgerName = "Personal";   // a fresh install's, or the pre-workspace one
+
+    explicit Workspace(const QString &directory, qint64 memoryBudget = DefaultMemoryBudget);
+
+    QStringList names() const { return ledgers.keys(); }   // sorted
+    bool contains(const QString &name) const { return ledgers.contains(name); }
+    bool isLoaded(const QString &name) const;
+    static bool isValidName(const QString &name);
+
+    // Loads name on first use; nullptr if there is no such ledger
+    std::shared_ptr<Ledger> ledger(const QString &name);
+    // An empty new ledger; nullptr if the name is invalid or taken
+    std::shared_ptr<Ledger> create(const QString &name);
+
+    qint64 memoryBudget() const { return budget; }
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryInUse() const;   // estimated, over the loaded ledgers
+
+    bool saveAll();   // folds every loaded ledger's journal into its snapshot
+
+private:
+    struct Loaded {
+        std::shared_ptr<Ledger> ledger;   // null while not loaded
+        quint64 lastUse = 0;
+        qint64 bytes = 0;                 // Ledger::memoryUsage() at the last access
+    };
+
+    QString pathOf(const QString &name) const;
+    void adoptSingleLedger();
+    void trim(const QString &keep);
+
+    QString directory;
+    qint64 budget;
+    quint64 useClock = 0;
+    QMap<QString, Loaded> ledgers;
+};
+
+#endif // WORKSPACE_H